@@ -0,0 +1,380 @@
+#ifndef __DIRECTORY_IMPORTER_HPP__
+#define __DIRECTORY_IMPORTER_HPP__
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <cstdlib>
+#include <cstdint>
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#include <filesystem>
+#else
+#include <experimental/filesystem>
+#endif
+
+#include "ResearchDocumentRepository.hpp"
+#include "ThreadPool.hpp"
+
+namespace Database
+{
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+namespace filesystem = std::filesystem;
+#else
+namespace filesystem = std::experimental::filesystem;
+#endif
+
+/**
+ * The DirectoryImporter adds a document for each file in a directory
+ * tree, the file's contents becoming the document's body.
+ *
+ * Titles, authors and publication times are taken from a manifest in
+ * the directory's root, if there is one (see ManifestName). Each line
+ * of the manifest describes a file, as tab separated fields:
+ *
+ *     path/to/file.txt <tab> Title <tab> Author; Other Author <tab> 1136073600
+ *
+ * giving its path relative to the root, title, authors separated by
+ * semicolons, and publication time in seconds since 1970. Files not
+ * in the manifest are titled by their name, with an unknown author.
+ *
+ * The tree is listed and files are read on a ThreadPool, so that many
+ * reads are in flight at once. Documents are only added by Step, StepFor
+ * (or Run), on the thread that owns the repository, in batches of those
+ * read so far. Progress can be read from any thread.
+ *
+ * Reading is held back while the documents waiting to be added take up
+ * more than a limit of memory (see ReadyLimit), so that a large tree
+ * isn't read into memory faster than it's added.
+ *
+ * Documents are added under new ids straight to the repository, not
+ * through a RepositoryHistory, which should be cleared as they are.
+ */
+class DirectoryImporter
+{
+public:
+	static const char *ManifestName() {
+		return "manifest.tsv";
+	}
+
+	// Default bytes of documents read and waiting to be added, beyond
+	// which no more files are read until some are added
+	enum { ReadyLimit = 64 * 1024 * 1024 };
+
+	/**
+	 * A Status reports the progress of an import
+	 */
+	struct Status {
+		size_t   files;  // Files found so far
+		size_t   read;   // Files read so far
+		size_t   added;  // Documents added so far
+		size_t   failed; // Files that couldn't be read, or documents rejected
+		uint64_t bytes;  // Bytes read so far
+		bool     listed; // Whether every file has been found
+	};
+
+	explicit DirectoryImporter(ResearchDocumentRepository &repository, size_t threads = std::thread::hardware_concurrency(), size_t readyLimit = ReadyLimit) :
+		repository(repository), readyBytes(0), readyLimit(readyLimit), status(), started(false), pending(0), cancelled(false), pool(threads) {
+	}
+
+	~DirectoryImporter() {
+		// Let queued reads finish quickly, they're waited for by the pool
+		Cancel();
+	}
+
+	DirectoryImporter(const DirectoryImporter &) = delete;
+	DirectoryImporter &operator=(const DirectoryImporter &) = delete;
+
+	/**
+	 * Start listing and reading the files of a directory tree. Returns
+	 * false if the directory doesn't exist or an import was already started.
+	 */
+	bool Start(const std::string &directory) {
+		std::error_code error;
+		filesystem::path root(directory);
+		if (started || !filesystem::is_directory(root, error)) {
+			return false;
+		}
+		started = true;
+
+		pool.Submit([this, root] {
+			list(root);
+		});
+		return true;
+	}
+
+	/**
+	 * Step adds up to batch of the documents read so far, returning
+	 * the number added. It must be called on the thread owning the
+	 * repository, and doesn't wait for files to be read.
+	 */
+	size_t Step(size_t batch = 256) {
+		std::vector<Document> documents;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			while (!ready.empty() && documents.size() < batch) {
+				readyBytes -= weight(ready.front());
+				documents.push_back(std::move(ready.front()));
+				ready.pop_front();
+			}
+		}
+
+		// Make room for more files to be read
+		if (!documents.empty()) {
+			changed.notify_all();
+		}
+
+		size_t added = 0, failed = 0;
+		for (auto &document : documents) {
+			document.SetId(repository.NextId());
+			if (repository.Add(std::move(document))) {
+				++added;
+			} else {
+				++failed;
+			}
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		status.added += added;
+		status.failed += failed;
+		return added;
+	}
+
+	/**
+	 * StepFor adds the documents read so far a few at a time, until
+	 * none are left or the given time has passed, returning the number
+	 * added. Like Step, it doesn't wait for files to be read.
+	 */
+	size_t StepFor(std::chrono::milliseconds time) {
+		auto deadline = std::chrono::steady_clock::now() + time;
+		size_t added = 0;
+		do {
+			added += Step(16);
+		} while (Ready() && std::chrono::steady_clock::now() < deadline);
+		return added;
+	}
+
+	/**
+	 * Ready returns whether there are documents read and waiting to be
+	 * added by the next Step
+	 */
+	bool Ready() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return !ready.empty();
+	}
+
+	/**
+	 * Run adds every document of the tree, waiting for files as they
+	 * are read, and returns the number added
+	 */
+	size_t Run() {
+		if (!started) {
+			return 0;
+		}
+
+		while (!Finished()) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				changed.wait(lock, [&] { return !ready.empty() || finished(); });
+			}
+			Step();
+		}
+		return Progress().added;
+	}
+
+	/**
+	 * Finished returns true once every file has been read and added
+	 */
+	bool Finished() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return finished();
+	}
+
+	/**
+	 * Return the progress of the import so far
+	 */
+	Status Progress() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return status;
+	}
+
+	/**
+	 * Cancel stops reading files. Those already read can still be added.
+	 */
+	void Cancel() {
+		std::lock_guard<std::mutex> lock(mutex);
+		cancelled = true;
+		changed.notify_all();
+	}
+
+private:
+	// Manifest details of a file
+	struct Entry {
+		std::string              title;
+		std::vector<std::string> authors;
+		std::time_t              published;
+	};
+
+	bool finished() const {
+		return started && status.listed && pending == 0 && ready.empty();
+	}
+
+	// List the tree, reading each file on the pool
+	void list(const filesystem::path &root) {
+		auto manifest = std::make_shared<std::map<std::string, Entry>>(readManifest(root / ManifestName()));
+
+		// Paths are matched against the manifest relative to the root
+		std::string prefix = root.generic_string();
+		if (!prefix.empty() && prefix.back() != '/') {
+			prefix += '/';
+		}
+
+		std::error_code error;
+		for (filesystem::recursive_directory_iterator it(root, error), end; !error && it != end && !cancelled; it.increment(error)) {
+			std::error_code statusError;
+			if (!filesystem::is_regular_file(it->status(statusError))) {
+				continue;
+			}
+
+			std::string path = it->path().generic_string();
+			std::string relative = path.compare(0, prefix.size(), prefix) == 0 ? path.substr(prefix.size()) : path;
+			if (relative == ManifestName()) {
+				continue;
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				++status.files;
+				++pending;
+			}
+
+			filesystem::path file = it->path();
+			pool.Submit([this, file, relative, manifest] {
+				read(file, relative, *manifest);
+			});
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		status.listed = true;
+		changed.notify_all();
+	}
+
+	// Read a file into a document, once there's room for it
+	void read(const filesystem::path &file, const std::string &relative, const std::map<std::string, Entry> &manifest) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			changed.wait(lock, [&] { return cancelled || readyBytes < readyLimit; });
+		}
+
+		std::string body;
+		bool ok = !cancelled && readFile(file, body);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		--pending;
+		if (ok) {
+			auto found = manifest.find(relative);
+			if (found != manifest.end()) {
+				const Entry &entry = found->second;
+				ready.push_back(Document(0, entry.authors.empty() ? "Unknown" : entry.authors[0], entry.title, std::move(body), entry.published));
+				for (size_t i = 1; i < entry.authors.size(); ++i) {
+					ready.back().Authors().push_back(entry.authors[i]);
+				}
+			} else {
+				ready.push_back(Document(0, "Unknown", file.filename().string(), std::move(body)));
+			}
+
+			++status.read;
+			status.bytes += ready.back().Body().size();
+			readyBytes += weight(ready.back());
+		} else {
+			++status.failed;
+		}
+		changed.notify_all();
+	}
+
+	// The memory a document waiting to be added is counted as taking
+	static size_t weight(const Document &document) {
+		return sizeof(Document) + document.Body().size();
+	}
+
+	static bool readFile(const filesystem::path &file, std::string &contents) {
+		std::ifstream in(file.string(), std::ios::binary | std::ios::ate);
+		if (!in) {
+			return false;
+		}
+
+		std::streamoff size = in.tellg();
+		if (size < 0) {
+			return false;
+		}
+
+		contents.resize(static_cast<size_t>(size));
+		in.seekg(0);
+		return size == 0 || in.read(&contents[0], size);
+	}
+
+	static std::map<std::string, Entry> readManifest(const filesystem::path &path) {
+		std::map<std::string, Entry> entries;
+		std::ifstream in(path.string());
+
+		std::string line;
+		while (std::getline(in, line)) {
+			if (!line.empty() && line.back() == '\r') {
+				line.pop_back();
+			}
+
+			std::vector<std::string> fields;
+			std::istringstream columns(line);
+			for (std::string field; std::getline(columns, field, '\t'); ) {
+				fields.push_back(field);
+			}
+			if (fields.empty() || fields[0].empty()) {
+				continue;
+			}
+
+			Entry entry;
+			entry.title = fields.size() > 1 ? fields[1] : filesystem::path(fields[0]).filename().string();
+			if (fields.size() > 2) {
+				std::istringstream names(fields[2]);
+				for (std::string name; std::getline(names, name, ';'); ) {
+					size_t first = name.find_first_not_of(' '), last = name.find_last_not_of(' ');
+					if (first != std::string::npos) {
+						entry.authors.push_back(name.substr(first, last - first + 1));
+					}
+				}
+			}
+			entry.published = fields.size() > 3 ? static_cast<std::time_t>(std::strtoll(fields[3].c_str(), nullptr, 10)) : std::time(nullptr);
+
+			entries[fields[0]] = std::move(entry);
+		}
+		return entries;
+	}
+
+private:
+	ResearchDocumentRepository &repository;
+
+	mutable std::mutex      mutex;
+	std::condition_variable changed;
+	std::deque<Document>    ready; // Read, and waiting to be added
+	size_t                  readyBytes;
+	size_t                  readyLimit;
+	Status                  status;
+	bool                    started;
+	size_t                  pending; // Files found but not yet read
+
+	std::atomic<bool> cancelled;
+	ThreadPool        pool;
+};
+
+};
+
+#endif
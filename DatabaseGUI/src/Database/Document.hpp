@@ -1,108 +1,265 @@
-#ifndef __DOCUMENT_HPP__
-#define __DOCUMENT_HPP__
-
-#include <vector>
-#include <string>
-#include <ctime>
-
-namespace Database
-{
-
-/**
- * The document class represents a research document and contains
- * a unique id, an array of authors, a title, document body and a
- * a date that the article was published.
- */
-class Document
-{
-public:
-	Document(unsigned int id, std::string mainAuthor, std::string title, std::string body, std::time_t published = std::time(nullptr)) :
-		id(id), title(title), body(body), published(published) {
-		authors.push_back(mainAuthor);
-	}
-
-	~Document(void) {
-	}
-
-	/**
-	 * Return document unique id
-	 */
-	const unsigned int Id(void) const {
-		return id;
-	}
-
-	/**
-	 * Set document unique id
-	 */
-	void SetId(unsigned int id) {
-		this->id = id;
-	}
-
-	/**
-	 * Return document authors (const protected)
-	 */
-	const std::vector<std::string> &Authors(void) const {
-		return authors;
-	}
-
-	/**
-	 * Return document authors' array for manipulation
-	 */
-	std::vector<std::string> &Authors(void) {
-		return authors;
-	}
-
-	/**
-	 * Return document title
-	 */
-	const std::string &Title(void) const {
-		return title;
-	}
-
-	/**
-	 * Set document title
-	 */
-	void SetTitle(std::string title) {
-		this->title = title;
-	}
-
-	/**
-	 * Return document body
-	 */
-	const std::string &Body(void) const {
-		return body;
-	}
-
-	/**
-	 * Set document body
-	 */
-	void SetBody(std::string body) {
-		this->body = body;
-	}
-
-	/**
-	 * Returned document published date
-	 */
-	const std::time_t &Published(void) const {
-		return published;
-	}
-
-	/**
-	 * Set document published date
-	 */
-	void SetPublished(std::time_t published) {
-		this->published = published;
-	}
-
-private:
-	unsigned int id;
-
-	std::vector<std::string> authors;
-	std::string title;
-	std::string body;
-	std::time_t published;
-};
-
-};
-
-#endif;
+#ifndef __DOCUMENT_HPP__
+#define __DOCUMENT_HPP__
+
+#include <vector>
+#include <string>
+#include <utility>
+#include <ctime>
+#include <atomic>
+#include <mutex>
+#include <type_traits>
+#include <cstdint>
+
+#include "InlineVector.hpp"
+
+namespace Database
+{
+
+/**
+ * A BodyStore holds the bodies of documents that have been evicted from
+ * memory (see SpillStore), for Document::Body to reload them.
+ */
+class BodyStore
+{
+public:
+	virtual ~BodyStore() {
+	}
+
+	/**
+	 * Write a body to the store, setting where it was written. Returns
+	 * false if it couldn't be written.
+	 */
+	virtual bool Write(const std::string &body, uint64_t &offset) = 0;
+
+	/**
+	 * Read back a body written to the store. Returns false if it
+	 * couldn't be read, leaving body unchanged.
+	 */
+	virtual bool Read(uint64_t offset, std::string &body) const = 0;
+
+	/**
+	 * Reloading is serialized, as documents may be read from many threads
+	 */
+	std::mutex &Mutex() const {
+		return mutex;
+	}
+
+private:
+	mutable std::mutex mutex;
+};
+
+/**
+ * The document class represents a research document and contains
+ * a unique id, an array of authors, a title, document body and a
+ * a date that the article was published.
+ *
+ * A stored document's body may be evicted to a BodyStore to save memory,
+ * in which case it is reloaded when next read. Copies of a document
+ * always hold their body in memory, reloading it if need be, outside
+ * any memory budget of the repository the original belongs to.
+ * Moving a document moves an evicted body's place in the store along
+ * with it.
+ *
+ * Most documents have only one or two authors, so those are held
+ * within the document itself (see AuthorList).
+ */
+class Document
+{
+public:
+	// The authors, held inline up to the most common number of them
+	typedef InlineVector<std::string, 2> AuthorList;
+
+	Document(unsigned int id, std::string mainAuthor, std::string title, std::string body, std::time_t published = std::time(nullptr)) :
+		id(id), title(std::move(title)), body(std::move(body)), published(published), store(nullptr), offset(0), recent(true) {
+		authors.push_back(std::move(mainAuthor));
+	}
+
+	// Documents may be large, so ensure moves are available and
+	// don't fall back to copying. Moves are noexcept, so that containers
+	// use them when growing, and leave the document moved from resident.
+	Document(const Document &other) :
+		id(other.id), authors(other.authors), title(other.title), body(other.Body()), published(other.published), store(nullptr), offset(0), recent(true) {
+	}
+
+	Document(Document &&other) noexcept :
+		id(other.id), authors(std::move(other.authors)), title(std::move(other.title)), body(std::move(other.body)), published(other.published),
+		store(other.store.exchange(nullptr, std::memory_order_acq_rel)), offset(other.offset), recent(true) {
+	}
+
+	Document &operator=(const Document &other) {
+		if (this != &other) {
+			id = other.id;
+			authors = other.authors;
+			title = other.title;
+			SetBody(other.Body());
+			published = other.published;
+		}
+		return *this;
+	}
+
+	Document &operator=(Document &&other) noexcept {
+		if (this != &other) {
+			id = other.id;
+			authors = std::move(other.authors);
+			title = std::move(other.title);
+			body = std::move(other.body);
+			published = other.published;
+			store.store(other.store.exchange(nullptr, std::memory_order_acq_rel), std::memory_order_release);
+			offset = other.offset;
+			recent.store(true, std::memory_order_relaxed);
+		}
+		return *this;
+	}
+
+	/**
+	 * Return document unique id
+	 */
+	const unsigned int Id(void) const {
+		return id;
+	}
+
+	/**
+	 * Set document unique id
+	 */
+	void SetId(unsigned int id) {
+		this->id = id;
+	}
+
+	/**
+	 * Return document authors (const protected)
+	 */
+	const AuthorList &Authors(void) const {
+		return authors;
+	}
+
+	/**
+	 * Return document authors' array for manipulation
+	 */
+	AuthorList &Authors(void) {
+		return authors;
+	}
+
+	/**
+	 * Return document title
+	 */
+	const std::string &Title(void) const {
+		return title;
+	}
+
+	/**
+	 * Set document title
+	 */
+	void SetTitle(std::string title) {
+		this->title = std::move(title);
+	}
+
+	/**
+	 * Return document body, reloading it if it was evicted
+	 */
+	const std::string &Body(void) const {
+		const BodyStore *from = store.load(std::memory_order_acquire);
+		if (from != nullptr) {
+			reload(from);
+		}
+		if (!recent.load(std::memory_order_relaxed)) {
+			recent.store(true, std::memory_order_relaxed);
+		}
+		return body;
+	}
+
+	/**
+	 * Set document body
+	 */
+	void SetBody(std::string body) {
+		this->body = std::move(body);
+		store.store(nullptr, std::memory_order_release);
+		recent.store(true, std::memory_order_relaxed);
+	}
+
+	/**
+	 * Evict writes the body to a store and frees it from memory. The
+	 * store must outlive the document, or its next change. Returns
+	 * whether the body was evicted; it stays in memory if the store
+	 * couldn't write it.
+	 */
+	bool Evict(BodyStore &store) {
+		if (!Resident() || !store.Write(body, offset)) {
+			return false;
+		}
+		std::string().swap(body);
+		this->store.store(&store, std::memory_order_release);
+		return true;
+	}
+
+	/**
+	 * Return whether the body is in memory
+	 */
+	bool Resident() const {
+		return store.load(std::memory_order_acquire) == nullptr;
+	}
+
+	/**
+	 * Return the bytes held in memory by the body
+	 */
+	size_t ResidentBytes() const {
+		return Resident() ? body.capacity() : 0;
+	}
+
+	/**
+	 * Recent returns whether the body has been read since ClearRecent
+	 * was last called, for choosing which bodies to evict
+	 */
+	bool Recent() const {
+		return recent.load(std::memory_order_relaxed);
+	}
+
+	void ClearRecent() const {
+		recent.store(false, std::memory_order_relaxed);
+	}
+
+	/**
+	 * Returned document published date
+	 */
+	const std::time_t &Published(void) const {
+		return published;
+	}
+
+	/**
+	 * Set document published date
+	 */
+	void SetPublished(std::time_t published) {
+		this->published = published;
+	}
+
+private:
+	// Reload an evicted body from the store it was seen in. Only one
+	// reader does so; the others wait, then find it already reloaded.
+	// If the store can't read it, the body stays evicted (and empty)
+	// for a later read to try again.
+	void reload(const BodyStore *from) const {
+		std::lock_guard<std::mutex> lock(from->Mutex());
+		if (store.load(std::memory_order_acquire) == from && from->Read(offset, body)) {
+			store.store(nullptr, std::memory_order_release);
+		}
+	}
+
+private:
+	unsigned int id;
+
+	AuthorList authors;
+	std::string title;
+	mutable std::string body;
+	std::time_t published;
+
+	// Where the body is while evicted, see Evict
+	mutable std::atomic<BodyStore*> store;
+	uint64_t                        offset;
+	mutable std::atomic<bool>       recent;
+};
+
+static_assert(std::is_nothrow_move_constructible<Document>::value && std::is_nothrow_move_assignable<Document>::value,
+              "Documents must move without copying in containers");
+
+};
+
+#endif;
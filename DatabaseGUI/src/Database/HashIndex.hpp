@@ -0,0 +1,425 @@
+#ifndef __HASH_INDEX_HPP__
+#define __HASH_INDEX_HPP__
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <cstdint>
+
+#include "Serialization.hpp"
+#include "MemoryAccounting.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DATABASE_HASH_INDEX_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Database
+{
+
+/**
+ * InsertPosting adds an id to a posting list, which is kept in order of
+ * id so that ErasePosting can find it by binary search. New ids are
+ * usually the largest, and are simply appended.
+ */
+template <class Postings>
+void InsertPosting(Postings &ids, unsigned int id) {
+	if (ids.empty() || ids.back() <= id) {
+		ids.push_back(id);
+	} else {
+		ids.insert(std::upper_bound(ids.begin(), ids.end(), id), id);
+	}
+}
+
+/**
+ * ErasePosting removes an id from a posting list kept in order by
+ * InsertPosting, returning false if it wasn't there
+ */
+template <class Postings>
+bool ErasePosting(Postings &ids, unsigned int id) {
+	auto it = std::lower_bound(ids.begin(), ids.end(), id);
+	if (it == ids.end() || *it != id) {
+		return false;
+	}
+	ids.erase(it);
+	return true;
+}
+
+/**
+ * The HashIndex maps keys (by default strings) to posting lists of ids,
+ * for exact-match lookups.
+ *
+ * It is a flat, open-addressing table in the style of SwissTable. Every
+ * slot has a control byte holding either 7 bits of its key's hash, or a
+ * marker for an empty or deleted slot. Slots are probed in groups of 16,
+ * whose control bytes are compared against the wanted hash bits at once
+ * (with SSE2 where available), so that keys are only compared for likely
+ * matches. Each slot stores its key's full hash inline, to avoid
+ * rehashing keys as the table grows.
+ *
+ * Posting lists are kept in order of id (see InsertPosting). The memory
+ * held by the table and its posting lists is counted by a
+ * TrackingAllocator (see MemoryUsage). Short posting lists are
+ * allocated from the index's own NodePool.
+ */
+template <class Key = std::string, class Hash = std::hash<Key>>
+class HashIndex
+{
+	static const size_t GroupSize = 16;
+
+	static const int8_t Empty   = -128; // 0b10000000
+	static const int8_t Deleted = -2;   // 0b11111110
+
+public:
+	typedef std::vector<unsigned int, TrackingAllocator<unsigned int>> Postings;
+
+private:
+	struct Slot {
+		uint64_t hash;
+		Key      key;
+		Postings ids;
+	};
+
+	typedef std::vector<int8_t, TrackingAllocator<int8_t>> Control;
+	typedef std::vector<Slot, TrackingAllocator<Slot>>     Slots;
+
+public:
+	HashIndex() : control(NewPooledAllocator<int8_t>()), slots(control.get_allocator()), size(0), deleted(0) {
+	}
+
+	/**
+	 * Insert adds an id to the postings of a key
+	 */
+	void Insert(const Key &key, unsigned int id) {
+		uint64_t hash = hashOf(key);
+
+		size_t found = find(key, hash);
+		if (found != npos) {
+			InsertPosting(slots[found].ids, id);
+			return;
+		}
+
+		// Grow, or clear out deleted slots, before the table fills up
+		if ((size + deleted + 1) * 8 > control.size() * 7) {
+			if (control.empty()) {
+				rehash(GroupSize);
+			} else {
+				rehash((size + 1) * 2 > control.size() * 7 / 8 ? control.size() * 2 : control.size());
+			}
+		}
+
+		size_t slot = findFree(hash);
+		if (control[slot] == Deleted) {
+			--deleted;
+		}
+
+		control[slot] = h2(hash);
+		slots[slot].hash = hash;
+		slots[slot].key = key;
+		slots[slot].ids = Postings(1, id, control.get_allocator());
+		++size;
+	}
+
+	/**
+	 * Erase removes an id from the postings of a key, and the key itself
+	 * once it has no postings left. Returns false if it wasn't present.
+	 */
+	bool Erase(const Key &key, unsigned int id) {
+		size_t found = find(key, hashOf(key));
+		if (found == npos) {
+			return false;
+		}
+
+		Postings &ids = slots[found].ids;
+		if (!ErasePosting(ids, id)) {
+			return false;
+		}
+
+		if (ids.empty()) {
+			// Leave a marker so probing continues past this slot
+			control[found] = Deleted;
+			slots[found].key = Key();
+			slots[found].ids.shrink_to_fit();
+			--size;
+			++deleted;
+		}
+		return true;
+	}
+
+	/**
+	 * Find returns the postings of a key, or null if it has none
+	 */
+	const Postings *Find(const Key &key) const {
+		size_t found = find(key, hashOf(key));
+		return found == npos ? nullptr : &slots[found].ids;
+	}
+
+	/**
+	 * Return the number of keys
+	 */
+	size_t Size() const {
+		return size;
+	}
+
+	/**
+	 * Return the bytes allocated for the table and posting lists
+	 */
+	size_t MemoryUsage() const {
+		return control.get_allocator().Bytes();
+	}
+
+	/**
+	 * ForEach calls func(key, postings) for every key, in no particular order
+	 */
+	template <class Func>
+	void ForEach(Func func) const {
+		for (size_t i = 0; i < control.size(); ++i) {
+			if (control[i] >= 0) {
+				func(slots[i].key, slots[i].ids);
+			}
+		}
+	}
+
+	/**
+	 * Save writes the table exactly as it is laid out in memory: the
+	 * control bytes, then a fixed-size record per key giving its slot and
+	 * hash, then the keys and postings themselves. Load can then restore
+	 * it without hashing or probing a single key.
+	 */
+	void Save(BinaryWriter &writer) const {
+		std::vector<SavedSlot> records;
+		std::string keys;
+		std::vector<unsigned int> ids;
+
+		for (size_t i = 0; i < control.size(); ++i) {
+			if (control[i] >= 0) {
+				SavedSlot record = {};
+				record.hash = slots[i].hash;
+				record.position = static_cast<uint32_t>(i);
+				record.keyOffset = static_cast<uint32_t>(keys.size());
+				record.postingsOffset = static_cast<uint32_t>(ids.size());
+				record.postingsCount = static_cast<uint32_t>(slots[i].ids.size());
+
+				KeyCodec<Key>::Encode(slots[i].key, keys);
+				record.keyLength = static_cast<uint32_t>(keys.size() - record.keyOffset);
+				ids.insert(ids.end(), slots[i].ids.begin(), slots[i].ids.end());
+
+				records.push_back(record);
+			}
+		}
+
+		writer.Write<uint64_t>(control.size());
+		writer.Write<uint64_t>(deleted);
+		writer.WriteArray(control.data(), control.size());
+		writer.Write<uint64_t>(records.size());
+		writer.WriteArray(records.data(), records.size());
+		writer.Write<uint64_t>(keys.size());
+		writer.WriteArray(keys.data(), keys.size());
+		writer.Write<uint64_t>(ids.size());
+		writer.WriteArray(ids.data(), ids.size());
+	}
+
+	/**
+	 * Load replaces the table with one written by Save. Returns false,
+	 * leaving the table empty, if what was written is inconsistent.
+	 */
+	bool Load(BinaryReader &reader) {
+		*this = HashIndex();
+
+		uint64_t capacity = 0, deletedCount = 0, recordCount = 0, keyBytes = 0, idCount = 0;
+		if (!reader.Read(capacity) || !reader.Read(deletedCount) || capacity % GroupSize != 0 || (capacity & (capacity - 1)) != 0) {
+			return false;
+		}
+		const int8_t *savedControl = reader.ReadArray<int8_t>(static_cast<size_t>(capacity));
+		if (savedControl == nullptr || !reader.Read(recordCount)) {
+			return false;
+		}
+		const SavedSlot *records = reader.ReadArray<SavedSlot>(static_cast<size_t>(recordCount));
+		if (records == nullptr || !reader.Read(keyBytes)) {
+			return false;
+		}
+		const char *keys = reader.ReadArray<char>(static_cast<size_t>(keyBytes));
+		if (keys == nullptr || !reader.Read(idCount)) {
+			return false;
+		}
+		const unsigned int *ids = reader.ReadArray<unsigned int>(static_cast<size_t>(idCount));
+		if (ids == nullptr) {
+			return false;
+		}
+
+		control.assign(savedControl, savedControl + capacity);
+		slots.resize(static_cast<size_t>(capacity));
+
+		for (size_t i = 0; i < recordCount; ++i) {
+			const SavedSlot &record = records[i];
+			if (record.position >= capacity || control[record.position] != h2(record.hash) ||
+			    static_cast<uint64_t>(record.keyOffset) + record.keyLength > keyBytes ||
+			    static_cast<uint64_t>(record.postingsOffset) + record.postingsCount > idCount ||
+			    !std::is_sorted(ids + record.postingsOffset, ids + record.postingsOffset + record.postingsCount) ||
+			    !KeyCodec<Key>::Decode(keys + record.keyOffset, record.keyLength, slots[record.position].key)) {
+				*this = HashIndex();
+				return false;
+			}
+
+			Slot &slot = slots[record.position];
+			slot.hash = record.hash;
+			slot.ids = Postings(ids + record.postingsOffset, ids + record.postingsOffset + record.postingsCount, control.get_allocator());
+		}
+
+		size = static_cast<size_t>(recordCount);
+		deleted = static_cast<size_t>(deletedCount);
+
+		// Every full control byte must have had a record
+		size_t full = static_cast<size_t>(std::count_if(control.begin(), control.end(), [](int8_t c) { return c >= 0; }));
+		if (full != size) {
+			*this = HashIndex();
+			return false;
+		}
+		return true;
+	}
+
+	/**
+	 * HashOf returns the hash used to place a key. Saved tables are only
+	 * valid while this is unchanged.
+	 */
+	static uint64_t HashOf(const Key &key) {
+		return hashOf(key);
+	}
+
+private:
+	// Layout of a key's record when saved
+	struct SavedSlot {
+		uint64_t hash;
+		uint32_t position;
+		uint32_t keyOffset;
+		uint32_t keyLength;
+		uint32_t postingsOffset;
+		uint32_t postingsCount;
+		uint32_t padding;
+	};
+
+	static const size_t npos = static_cast<size_t>(-1);
+	static const size_t stop = static_cast<size_t>(-2);
+
+	// Hash a key, mixing the bits so that both the group index (high
+	// bits) and control byte (low bits) are well distributed
+	static uint64_t hashOf(const Key &key) {
+		uint64_t hash = static_cast<uint64_t>(Hash()(key));
+		hash *= 0x9E3779B97F4A7C15ull;
+		return hash ^ (hash >> 32);
+	}
+
+	static int8_t h2(uint64_t hash) {
+		return static_cast<int8_t>(hash & 0x7F);
+	}
+
+	// Return a bit mask of positions in the group at offset whose
+	// control byte equals value
+	unsigned int match(size_t offset, int8_t value) const {
+#if defined(DATABASE_HASH_INDEX_SSE2)
+		__m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&control[offset]));
+		return static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(value))));
+#else
+		unsigned int mask = 0;
+		for (size_t i = 0; i < GroupSize; ++i) {
+			if (control[offset + i] == value) {
+				mask |= 1u << i;
+			}
+		}
+		return mask;
+#endif
+	}
+
+	// Groups are probed quadratically, which visits every group
+	// as the number of groups is a power of two. Probing continues
+	// while visit returns npos.
+	template <class Visit>
+	size_t probe(uint64_t hash, Visit visit) const {
+		size_t groups = control.size() / GroupSize;
+		if (groups == 0) {
+			return npos;
+		}
+
+		size_t group = static_cast<size_t>(hash >> 7) & (groups - 1);
+		for (size_t step = 1; step <= groups; ++step) {
+			size_t found = visit(group * GroupSize);
+			if (found != npos) {
+				return found;
+			}
+			group = (group + step) & (groups - 1);
+		}
+		return npos;
+	}
+
+	// Find the slot holding a key
+	size_t find(const Key &key, uint64_t hash) const {
+		int8_t wanted = h2(hash);
+		size_t found = probe(hash, [&](size_t offset) -> size_t {
+			for (unsigned int mask = match(offset, wanted); mask != 0; mask &= mask - 1) {
+				size_t slot = offset + lowestBit(mask);
+				if (slots[slot].hash == hash && slots[slot].key == key) {
+					return slot;
+				}
+			}
+
+			// An empty slot ends the search, as the key would have been placed there
+			return match(offset, Empty) != 0 ? stop : npos;
+		});
+		return found == stop ? npos : found;
+	}
+
+	// Find an empty or deleted slot for a new key
+	size_t findFree(uint64_t hash) const {
+		return probe(hash, [&](size_t offset) -> size_t {
+			for (size_t i = 0; i < GroupSize; ++i) {
+				if (control[offset + i] < 0) {
+					return offset + i;
+				}
+			}
+			return npos;
+		});
+	}
+
+	// Rebuild the table with the given number of slots
+	void rehash(size_t capacity) {
+		Control oldControl(capacity, static_cast<int8_t>(Empty), control.get_allocator());
+		Slots oldSlots(capacity, slots.get_allocator());
+		oldControl.swap(control);
+		oldSlots.swap(slots);
+
+		deleted = 0;
+		for (size_t i = 0; i < oldControl.size(); ++i) {
+			if (oldControl[i] >= 0) {
+				size_t slot = findFree(oldSlots[i].hash);
+				control[slot] = oldControl[i];
+				slots[slot] = std::move(oldSlots[i]);
+			}
+		}
+	}
+
+	// Return the index of the lowest set bit of a non-zero mask
+	static unsigned int lowestBit(unsigned int mask) {
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return static_cast<unsigned int>(index);
+#else
+		return static_cast<unsigned int>(__builtin_ctz(mask));
+#endif
+	}
+
+private:
+	Control control;
+	Slots   slots;
+	size_t size;
+	size_t deleted;
+};
+
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef __ID_SET_HPP__
+#define __ID_SET_HPP__
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+namespace Database
+{
+
+/**
+ * An IdSet is a bitmap of ids, such as those of a query's results.
+ * Testing whether an id is in the set is a shift and a mask, so an
+ * index's postings can be intersected with it cheaply (see
+ * Repository::Facet).
+ *
+ * Like an IdTable, the bitmap is split into pages that are only
+ * allocated once an id within them is inserted, so that a few large
+ * ids don't take a bit for every id below them.
+ */
+class IdSet
+{
+	static const unsigned int PageBits = 16;
+	static const unsigned int PageWords = (1u << PageBits) / 64;
+
+public:
+	IdSet() : count(0) {
+	}
+
+	/**
+	 * Insert adds an id to the set
+	 */
+	void Insert(unsigned int id) {
+		unsigned int page = id >> PageBits;
+		if (page >= pages.size()) {
+			pages.resize(page + 1);
+		}
+		if (!pages[page]) {
+			pages[page].reset(new uint64_t[PageWords]());
+		}
+
+		uint64_t &word = pages[page][(id >> 6) & (PageWords - 1)];
+		uint64_t bit = uint64_t(1) << (id % 64);
+		if ((word & bit) == 0) {
+			word |= bit;
+			++count;
+		}
+	}
+
+	/**
+	 * Return whether an id is in the set
+	 */
+	bool Contains(unsigned int id) const {
+		unsigned int page = id >> PageBits;
+		if (page >= pages.size() || !pages[page]) {
+			return false;
+		}
+		return (pages[page][(id >> 6) & (PageWords - 1)] >> (id % 64) & 1) != 0;
+	}
+
+	/**
+	 * Return the number of ids in the set
+	 */
+	size_t Size() const {
+		return count;
+	}
+
+private:
+	std::vector<std::unique_ptr<uint64_t[]>> pages;
+	size_t                                   count;
+};
+
+};
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef __ID_TABLE_HPP__
+#define __ID_TABLE_HPP__
+
+#include <vector>
+#include <memory>
+
+namespace Database
+{
+
+/**
+ * The IdTable maps unsigned integer ids directly to slots, using a
+ * two-level page table: the upper bits of an id select a page, and the
+ * lower bits the entry within it. Pages are only allocated once an id
+ * within them is used, so sparse ids stay cheap, while a lookup is a
+ * fixed two loads rather than a tree walk.
+ *
+ * Every id also has a generation, which is incremented each time the
+ * id is erased, so that reuse of an id can be detected, and a version,
+ * which is incremented each time it is inserted or touched, so that any
+ * change to what it refers to can be detected.
+ */
+template <class Slot>
+class IdTable
+{
+	static const unsigned int PageBits = 12;
+	static const unsigned int PageSize = 1u << PageBits;
+
+	struct Entry {
+		Slot         slot;
+		unsigned int generation;
+		unsigned int version;
+		bool         used;
+	};
+
+public:
+	/**
+	 * Find returns the slot for an id, or null if the id isn't in use
+	 */
+	const Slot *Find(unsigned int id) const {
+		unsigned int page = id >> PageBits;
+		if (page >= pages.size() || !pages[page]) {
+			return nullptr;
+		}
+
+		const Entry &entry = pages[page][id & (PageSize - 1)];
+		return entry.used ? &entry.slot : nullptr;
+	}
+
+	Slot *Find(unsigned int id) {
+		return const_cast<Slot*>(static_cast<const IdTable&>(*this).Find(id));
+	}
+
+	/**
+	 * Insert sets the slot for an unused id. Returns false if the id is in use.
+	 */
+	bool Insert(unsigned int id, Slot slot) {
+		unsigned int page = id >> PageBits;
+		if (page >= pages.size()) {
+			pages.resize(page + 1);
+		}
+		if (!pages[page]) {
+			pages[page].reset(new Entry[PageSize]());
+			++allocated;
+		}
+
+		Entry &entry = pages[page][id & (PageSize - 1)];
+		if (entry.used) {
+			return false;
+		}
+
+		entry.slot = slot;
+		entry.used = true;
+		++entry.version;
+		++count;
+		return true;
+	}
+
+	/**
+	 * Erase frees an id, moving it on to its next generation.
+	 * Returns false if the id isn't in use.
+	 */
+	bool Erase(unsigned int id) {
+		unsigned int page = id >> PageBits;
+		if (page >= pages.size() || !pages[page]) {
+			return false;
+		}
+
+		Entry &entry = pages[page][id & (PageSize - 1)];
+		if (!entry.used) {
+			return false;
+		}
+
+		entry.slot = Slot();
+		entry.used = false;
+		++entry.generation;
+		--count;
+		return true;
+	}
+
+	/**
+	 * Touch moves an id in use on to its next version.
+	 * Returns false if the id isn't in use.
+	 */
+	bool Touch(unsigned int id) {
+		unsigned int page = id >> PageBits;
+		if (page >= pages.size() || !pages[page] || !pages[page][id & (PageSize - 1)].used) {
+			return false;
+		}
+
+		++pages[page][id & (PageSize - 1)].version;
+		return true;
+	}
+
+	/**
+	 * Return how many times an id has been inserted or touched
+	 */
+	unsigned int Version(unsigned int id) const {
+		unsigned int page = id >> PageBits;
+		if (page >= pages.size() || !pages[page]) {
+			return 0;
+		}
+
+		return pages[page][id & (PageSize - 1)].version;
+	}
+
+	/**
+	 * Return how many times an id has been erased
+	 */
+	unsigned int Generation(unsigned int id) const {
+		unsigned int page = id >> PageBits;
+		if (page >= pages.size() || !pages[page]) {
+			return 0;
+		}
+
+		return pages[page][id & (PageSize - 1)].generation;
+	}
+
+	/**
+	 * Return the number of ids in use
+	 */
+	size_t Size() const {
+		return count;
+	}
+
+	/**
+	 * Return the bytes allocated for the table
+	 */
+	size_t MemoryUsage() const {
+		return pages.capacity() * sizeof(pages[0]) + allocated * PageSize * sizeof(Entry);
+	}
+
+private:
+	std::vector<std::unique_ptr<Entry[]>> pages;
+	size_t count = 0;
+	size_t allocated = 0; // Pages
+};
+
+};
+
+#endif
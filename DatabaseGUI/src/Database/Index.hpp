@@ -0,0 +1,412 @@
+#ifndef __INDEX_HPP__
+#define __INDEX_HPP__
+
+#include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
+#include <iterator>
+#include <cstdint>
+
+#include "HashIndex.hpp"
+#include "Serialization.hpp"
+#include "MemoryAccounting.hpp"
+
+namespace Database
+{
+
+/**
+ * The OrderedIndex maps keys to posting lists of ids, keeping keys in
+ * order for range and prefix queries. Posting lists are kept in order
+ * of id (see InsertPosting).
+ *
+ * The memory held by the tree and its posting lists is counted by a
+ * TrackingAllocator (see MemoryUsage). Tree nodes and short posting
+ * lists are allocated from the index's own NodePool.
+ */
+template <class Key, class Compare = std::less<Key>>
+class OrderedIndex
+{
+public:
+	typedef std::vector<unsigned int, TrackingAllocator<unsigned int>>                           Postings;
+	typedef std::map<Key, Postings, Compare, TrackingAllocator<std::pair<const Key, Postings>>> Map;
+
+	OrderedIndex() : keys(Compare(), NewPooledAllocator<std::pair<const Key, Postings>>()) {
+	}
+
+	/**
+	 * Insert adds an id to the postings of a key
+	 */
+	void Insert(const Key &key, unsigned int id) {
+		auto found = keys.lower_bound(key);
+		if (found == keys.end() || keys.key_comp()(key, found->first)) {
+			found = keys.emplace_hint(found, key, Postings(keys.get_allocator()));
+		}
+		InsertPosting(found->second, id);
+	}
+
+	/**
+	 * Erase removes an id from the postings of a key, and the key itself
+	 * once it has no postings left. Returns false if it wasn't present.
+	 */
+	bool Erase(const Key &key, unsigned int id) {
+		auto found = keys.find(key);
+		if (found == keys.end()) {
+			return false;
+		}
+
+		if (!ErasePosting(found->second, id)) {
+			return false;
+		}
+
+		if (found->second.empty()) {
+			keys.erase(found);
+		}
+		return true;
+	}
+
+	/**
+	 * Find returns the postings of a key, or null if it has none
+	 */
+	const Postings *Find(const Key &key) const {
+		auto found = keys.find(key);
+		return found == keys.end() ? nullptr : &found->second;
+	}
+
+	/**
+	 * Return the number of keys
+	 */
+	size_t Size() const {
+		return keys.size();
+	}
+
+	/**
+	 * Return the bytes allocated for the tree and posting lists
+	 */
+	size_t MemoryUsage() const {
+		return keys.get_allocator().Bytes();
+	}
+
+	/**
+	 * ForEach calls func(key, postings) for every key, in order
+	 */
+	template <class Func>
+	void ForEach(Func func) const {
+		for (auto &entry : keys) {
+			func(entry.first, entry.second);
+		}
+	}
+
+	/**
+	 * Save writes a record per key, in order, followed by the keys
+	 * and postings themselves
+	 */
+	void Save(BinaryWriter &writer) const {
+		std::vector<SavedKey> records;
+		std::string bytes;
+		std::vector<unsigned int> ids;
+
+		for (auto &entry : keys) {
+			SavedKey record = {};
+			record.keyOffset = static_cast<uint32_t>(bytes.size());
+			record.postingsOffset = static_cast<uint32_t>(ids.size());
+			record.postingsCount = static_cast<uint32_t>(entry.second.size());
+
+			KeyCodec<Key>::Encode(entry.first, bytes);
+			record.keyLength = static_cast<uint32_t>(bytes.size() - record.keyOffset);
+			ids.insert(ids.end(), entry.second.begin(), entry.second.end());
+
+			records.push_back(record);
+		}
+
+		writer.Write<uint64_t>(records.size());
+		writer.WriteArray(records.data(), records.size());
+		writer.Write<uint64_t>(bytes.size());
+		writer.WriteArray(bytes.data(), bytes.size());
+		writer.Write<uint64_t>(ids.size());
+		writer.WriteArray(ids.data(), ids.size());
+	}
+
+	/**
+	 * Load replaces the index with one written by Save. As keys were
+	 * saved in order, each is appended without searching the tree.
+	 */
+	bool Load(BinaryReader &reader) {
+		keys.clear();
+		typename Postings::allocator_type allocator(keys.get_allocator());
+
+		uint64_t recordCount = 0, byteCount = 0, idCount = 0;
+		if (!reader.Read(recordCount)) {
+			return false;
+		}
+		const SavedKey *records = reader.ReadArray<SavedKey>(static_cast<size_t>(recordCount));
+		if (records == nullptr || !reader.Read(byteCount)) {
+			return false;
+		}
+		const char *bytes = reader.ReadArray<char>(static_cast<size_t>(byteCount));
+		if (bytes == nullptr || !reader.Read(idCount)) {
+			return false;
+		}
+		const unsigned int *ids = reader.ReadArray<unsigned int>(static_cast<size_t>(idCount));
+		if (ids == nullptr) {
+			return false;
+		}
+
+		for (size_t i = 0; i < recordCount; ++i) {
+			const SavedKey &record = records[i];
+			Key key;
+			if (static_cast<uint64_t>(record.keyOffset) + record.keyLength > byteCount ||
+			    static_cast<uint64_t>(record.postingsOffset) + record.postingsCount > idCount ||
+			    !std::is_sorted(ids + record.postingsOffset, ids + record.postingsOffset + record.postingsCount) ||
+			    !KeyCodec<Key>::Decode(bytes + record.keyOffset, record.keyLength, key) ||
+			    (!keys.empty() && !keys.key_comp()(keys.rbegin()->first, key))) {
+				keys.clear();
+				return false;
+			}
+
+			keys.emplace_hint(keys.end(), std::move(key), Postings(ids + record.postingsOffset, ids + record.postingsOffset + record.postingsCount, allocator));
+		}
+		return true;
+	}
+
+	/**
+	 * Return the underlying ordered map, for range queries
+	 */
+	const Map &Keys() const {
+		return keys;
+	}
+
+private:
+	// Layout of a key's record when saved
+	struct SavedKey {
+		uint32_t keyOffset;
+		uint32_t keyLength;
+		uint32_t postingsOffset;
+		uint32_t postingsCount;
+	};
+
+	Map keys;
+};
+
+// Index kinds, selecting the structure used to hold an index's keys
+struct Hashed {
+	template <class Key>
+	struct Container {
+		typedef HashIndex<Key> Type;
+	};
+};
+
+struct Ordered {
+	template <class Key>
+	struct Container {
+		typedef OrderedIndex<Key> Type;
+	};
+};
+
+// Index uniqueness, whether a key may belong to more than one entity
+struct Multi {
+	static const bool IsUnique = false;
+};
+
+struct Unique {
+	static const bool IsUnique = true;
+};
+
+/**
+ * An Index is a compile-time index policy for a Repository.
+ *
+ * The Extractor describes what an entity is indexed by, and also
+ * names the index when querying the repository. It provides a Key type
+ * and a static Extract(entity, func) method, calling func once for each
+ * of the entity's keys (any number of times, for multi-valued fields).
+ *
+ * The Kind (Hashed or Ordered) selects the structure holding the keys,
+ * and the Uniqueness (Multi or Unique) whether a key may be shared.
+ */
+template <class Extractor, class Kind = Hashed, class Uniqueness = Multi>
+class Index
+{
+public:
+	typedef Extractor                                                Tag;
+	typedef typename Extractor::Key                                  Key;
+	typedef typename Kind::template Container<Key>::Type             Container;
+	typedef typename Container::Postings                             Postings;
+
+	// An entity's keys before it's changed, and its Hash when the
+	// Extractor provides one, for Reindex to tell if they could differ
+	struct Snapshot {
+		std::vector<Key> keys;
+		uint64_t         hash;
+		bool             hashed;
+	};
+
+	static const bool IsUnique = Uniqueness::IsUnique;
+
+	/**
+	 * CanInsert returns false if inserting the entity would break
+	 * a unique index.
+	 */
+	template <class T>
+	bool CanInsert(const T &entity, unsigned int id) const {
+		if (!IsUnique) {
+			return true;
+		}
+
+		bool allowed = true;
+		Extractor::Extract(entity, [&](const Key &key) {
+			auto found = keys.Find(key);
+			if (found != nullptr && (found->size() != 1 || found->front() != id)) {
+				allowed = false;
+			}
+		});
+		return allowed;
+	}
+
+	template <class T>
+	void Insert(const T &entity, unsigned int id) {
+		Extractor::Extract(entity, [&](const Key &key) {
+			keys.Insert(key, id);
+		});
+	}
+
+	template <class T>
+	void Erase(const T &entity, unsigned int id) {
+		Extractor::Extract(entity, [&](const Key &key) {
+			keys.Erase(key, id);
+		});
+	}
+
+	/**
+	 * Take records an entity's keys, so that they can be compared by
+	 * Reindex after the entity is changed.
+	 */
+	template <class T>
+	Snapshot Take(const T &entity) const {
+		Snapshot snapshot;
+		snapshot.hash = 0;
+		snapshot.hashed = ownHash<Extractor>(entity, snapshot.hash, 0);
+		snapshot.keys = keysOf(entity);
+		return snapshot;
+	}
+
+	/**
+	 * Reindex updates only the keys that differ between a snapshot
+	 * and the entity's current state. When the Extractor provides a
+	 * Hash, and it hasn't changed, the keys aren't extracted again.
+	 */
+	template <class T>
+	void Reindex(Snapshot snapshot, const T &entity, unsigned int id) {
+		uint64_t hash = 0;
+		if (snapshot.hashed && ownHash<Extractor>(entity, hash, 0) && hash == snapshot.hash) {
+			return;
+		}
+
+		std::vector<Key> before = std::move(snapshot.keys);
+		std::vector<Key> after = keysOf(entity);
+		if (before == after) {
+			return;
+		}
+
+		std::sort(before.begin(), before.end());
+		std::sort(after.begin(), after.end());
+
+		std::vector<Key> removed, added;
+		std::set_difference(before.begin(), before.end(), after.begin(), after.end(), std::back_inserter(removed));
+		std::set_difference(after.begin(), after.end(), before.begin(), before.end(), std::back_inserter(added));
+
+		for (auto &key : removed) {
+			keys.Erase(key, id);
+		}
+		for (auto &key : added) {
+			keys.Insert(key, id);
+		}
+	}
+
+	/**
+	 * Find returns the postings of a key, or null if it has none
+	 */
+	const Postings *Find(const Key &key) const {
+		return keys.Find(key);
+	}
+
+	/**
+	 * Hash combines the hashes of an entity's keys, for fingerprinting
+	 * the contents of the index. An Extractor whose keys are costly to
+	 * extract may provide a static Hash(entity) of what they're extracted
+	 * from, which is used instead.
+	 */
+	template <class T>
+	static uint64_t Hash(const T &entity) {
+		uint64_t hash = 0;
+		if (ownHash<Extractor>(entity, hash, 0)) {
+			return hash;
+		}
+
+		std::string bytes;
+		Extractor::Extract(entity, [&](const Key &key) {
+			bytes.clear();
+			KeyCodec<Key>::Encode(key, bytes);
+			hash = Checksum(bytes.data(), bytes.size(), hash * 31 + 17);
+		});
+		return hash;
+	}
+
+	void Save(BinaryWriter &writer) const {
+		keys.Save(writer);
+	}
+
+	bool Load(BinaryReader &reader) {
+		return keys.Load(reader);
+	}
+
+	/**
+	 * Return the bytes allocated for the index
+	 */
+	size_t MemoryUsage() const {
+		return keys.MemoryUsage();
+	}
+
+	/**
+	 * Clear empties the index
+	 */
+	void Clear() {
+		keys = Container();
+	}
+
+	/**
+	 * Return the structure holding the keys
+	 */
+	const Container &Keys() const {
+		return keys;
+	}
+
+private:
+	template <class T>
+	static std::vector<Key> keysOf(const T &entity) {
+		std::vector<Key> keys;
+		Extractor::Extract(entity, [&](const Key &key) {
+			keys.push_back(key);
+		});
+		return keys;
+	}
+
+	// Set hash to the Extractor's own Hash of an entity, returning
+	// false if it doesn't provide one
+	template <class E, class T>
+	static auto ownHash(const T &entity, uint64_t &hash, int) -> decltype(E::Hash(entity), bool()) {
+		hash = E::Hash(entity);
+		return true;
+	}
+
+	template <class E, class T>
+	static bool ownHash(const T &, uint64_t &, long) {
+		return false;
+	}
+
+private:
+	Container keys;
+};
+
+};
+
+#endif
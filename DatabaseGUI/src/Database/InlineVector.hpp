@@ -0,0 +1,249 @@
+#ifndef __INLINE_VECTOR_HPP__
+#define __INLINE_VECTOR_HPP__
+
+#include <new>
+#include <memory>
+#include <utility>
+#include <algorithm>
+#include <initializer_list>
+#include <type_traits>
+#include <cstddef>
+#include <cstdint>
+
+namespace Database
+{
+
+/**
+ * An InlineVector is a vector holding up to N elements within itself,
+ * only allocating once it grows beyond them. It suits short lists held
+ * by many objects, such as a document's authors, which would otherwise
+ * each need an allocation of their own.
+ *
+ * It offers the parts of std::vector's interface in use here. As with
+ * std::vector, growing invalidates references to the elements, and so
+ * does moving a vector whose elements are held inline.
+ */
+template <class T, size_t N>
+class InlineVector
+{
+public:
+	typedef T         value_type;
+	typedef size_t    size_type;
+	typedef T        &reference;
+	typedef const T  &const_reference;
+	typedef T        *iterator;
+	typedef const T  *const_iterator;
+
+	InlineVector() : elements(local()), count(0), capacity(N) {
+	}
+
+	InlineVector(std::initializer_list<T> values) : InlineVector() {
+		reserve(values.size());
+		for (auto &value : values) {
+			push_back(value);
+		}
+	}
+
+	InlineVector(const InlineVector &other) : InlineVector() {
+		reserve(other.size());
+		for (auto &value : other) {
+			push_back(value);
+		}
+	}
+
+	InlineVector(InlineVector &&other) noexcept(std::is_nothrow_move_constructible<T>::value) : InlineVector() {
+		take(other);
+	}
+
+	~InlineVector() {
+		clear();
+		release();
+	}
+
+	InlineVector &operator=(const InlineVector &other) {
+		if (this != &other) {
+			clear();
+			reserve(other.size());
+			for (auto &value : other) {
+				push_back(value);
+			}
+		}
+		return *this;
+	}
+
+	InlineVector &operator=(InlineVector &&other) noexcept(std::is_nothrow_move_constructible<T>::value) {
+		if (this != &other) {
+			clear();
+			release();
+			take(other);
+		}
+		return *this;
+	}
+
+	iterator begin() {
+		return elements;
+	}
+
+	iterator end() {
+		return elements + count;
+	}
+
+	const_iterator begin() const {
+		return elements;
+	}
+
+	const_iterator end() const {
+		return elements + count;
+	}
+
+	size_t size() const {
+		return count;
+	}
+
+	bool empty() const {
+		return count == 0;
+	}
+
+	T &operator[](size_t i) {
+		return elements[i];
+	}
+
+	const T &operator[](size_t i) const {
+		return elements[i];
+	}
+
+	T &front() {
+		return elements[0];
+	}
+
+	const T &front() const {
+		return elements[0];
+	}
+
+	T &back() {
+		return elements[count - 1];
+	}
+
+	const T &back() const {
+		return elements[count - 1];
+	}
+
+	void push_back(const T &value) {
+		emplace_back(value);
+	}
+
+	void push_back(T &&value) {
+		emplace_back(std::move(value));
+	}
+
+	template <class... Args>
+	T &emplace_back(Args&&... args) {
+		if (count == capacity) {
+			// Construct first, as the arguments may refer to an element
+			T value(std::forward<Args>(args)...);
+			grow(capacity * 2);
+			return *new (elements + count++) T(std::move(value));
+		}
+		return *new (elements + count++) T(std::forward<Args>(args)...);
+	}
+
+	void reserve(size_t size) {
+		if (size > capacity) {
+			grow(size);
+		}
+	}
+
+	void clear() {
+		for (size_t i = 0; i < count; ++i) {
+			elements[i].~T();
+		}
+		count = 0;
+	}
+
+	/**
+	 * Return whether the elements are held within the vector itself
+	 */
+	bool IsInline() const {
+		return elements == local();
+	}
+
+private:
+	T *local() {
+		return reinterpret_cast<T*>(&storage);
+	}
+
+	const T *local() const {
+		return reinterpret_cast<const T*>(&storage);
+	}
+
+	// Move the elements to a heap block of a larger capacity
+	void grow(size_t size) {
+		T *block = static_cast<T*>(::operator new(size * sizeof(T)));
+		for (size_t i = 0; i < count; ++i) {
+			new (block + i) T(std::move(elements[i]));
+			elements[i].~T();
+		}
+
+		release();
+		elements = block;
+		capacity = static_cast<uint32_t>(size);
+	}
+
+	// Free a heap block, returning to the inline elements
+	void release() {
+		if (!IsInline()) {
+			::operator delete(elements);
+			elements = local();
+			capacity = N;
+		}
+	}
+
+	// Take the elements of another, which is left empty. A heap block
+	// is taken as it is; inline elements are moved one at a time.
+	void take(InlineVector &other) {
+		if (other.IsInline()) {
+			for (auto &value : other) {
+				new (elements + count++) T(std::move(value));
+			}
+			other.clear();
+		} else {
+			elements = other.elements;
+			count = other.count;
+			capacity = other.capacity;
+			other.elements = other.local();
+			other.count = 0;
+			other.capacity = N;
+		}
+	}
+
+private:
+	T       *elements; // The inline elements, or a heap block
+	uint32_t count;
+	uint32_t capacity;
+
+	typename std::aligned_storage<sizeof(T) * N, alignof(T)>::type storage;
+};
+
+template <class T, size_t N>
+bool operator==(const InlineVector<T, N> &a, const InlineVector<T, N> &b) {
+	return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+template <class T, size_t N>
+bool operator!=(const InlineVector<T, N> &a, const InlineVector<T, N> &b) {
+	return !(a == b);
+}
+
+template <class T, size_t N>
+bool operator<(const InlineVector<T, N> &a, const InlineVector<T, N> &b) {
+	return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end());
+}
+
+template <class T, size_t N>
+bool operator>(const InlineVector<T, N> &a, const InlineVector<T, N> &b) {
+	return b < a;
+}
+
+};
+
+#endif
@@ -0,0 +1,173 @@
+#ifndef __MEMORY_ACCOUNTING_HPP__
+#define __MEMORY_ACCOUNTING_HPP__
+
+#include <memory>
+#include <atomic>
+#include <vector>
+#include <numeric>
+#include <cstddef>
+#include <type_traits>
+#include <limits>
+
+#include "NodePool.hpp"
+
+namespace Database
+{
+
+/**
+ * A MemoryCounter keeps a running total of the bytes allocated
+ * for a structure. A pooled counter also holds a NodePool, from which
+ * the structure's small blocks are allocated.
+ */
+class MemoryCounter
+{
+public:
+	explicit MemoryCounter(bool pooled = false) : bytes(0), pool(pooled ? new NodePool() : nullptr) {
+	}
+
+	void Add(size_t size) {
+		bytes += size;
+	}
+
+	void Remove(size_t size) {
+		bytes -= size;
+	}
+
+	size_t Bytes() const {
+		return bytes;
+	}
+
+	NodePool *Pool() const {
+		return pool.get();
+	}
+
+private:
+	std::atomic<size_t>       bytes;
+	std::unique_ptr<NodePool> pool;
+};
+
+/**
+ * The TrackingAllocator allocates as std::allocator does, counting the
+ * bytes held against a MemoryCounter shared by every container of a
+ * structure. An allocator without a counter allocates without counting.
+ * If the counter is pooled, blocks come from its NodePool instead, so
+ * a structure's nodes are packed together and released along with it.
+ *
+ * The allocator travels with the memory it allocated when a container is
+ * moved, swapped or assigned, so memory is always returned to the counter
+ * it was taken from.
+ */
+template <class T>
+class TrackingAllocator
+{
+public:
+	typedef T value_type;
+
+	typedef std::true_type propagate_on_container_copy_assignment;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	TrackingAllocator() {
+	}
+
+	explicit TrackingAllocator(std::shared_ptr<MemoryCounter> counter) : counter(std::move(counter)) {
+	}
+
+	template <class U>
+	TrackingAllocator(const TrackingAllocator<U> &other) : counter(other.Counter()) {
+	}
+
+	T *allocate(size_t n) {
+		T *memory;
+		if (pooled()) {
+			if (n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+				throw std::bad_alloc();
+			}
+			memory = static_cast<T*>(counter->Pool()->Allocate(n * sizeof(T)));
+		} else {
+			memory = std::allocator<T>().allocate(n);
+		}
+
+		if (counter) {
+			counter->Add(n * sizeof(T));
+		}
+		return memory;
+	}
+
+	void deallocate(T *memory, size_t n) {
+		if (counter) {
+			counter->Remove(n * sizeof(T));
+		}
+
+		if (pooled()) {
+			counter->Pool()->Deallocate(memory, n * sizeof(T));
+		} else {
+			std::allocator<T>().deallocate(memory, n);
+		}
+	}
+
+	const std::shared_ptr<MemoryCounter> &Counter() const {
+		return counter;
+	}
+
+	/**
+	 * Return the bytes allocated against the counter, if there is one
+	 */
+	size_t Bytes() const {
+		return counter ? counter->Bytes() : 0;
+	}
+
+private:
+	bool pooled() const {
+		return counter && counter->Pool() != nullptr && alignof(T) <= NodePool::Alignment;
+	}
+
+private:
+	std::shared_ptr<MemoryCounter> counter;
+};
+
+template <class T, class U>
+bool operator==(const TrackingAllocator<T> &a, const TrackingAllocator<U> &b) {
+	return a.Counter() == b.Counter();
+}
+
+template <class T, class U>
+bool operator!=(const TrackingAllocator<T> &a, const TrackingAllocator<U> &b) {
+	return !(a == b);
+}
+
+/**
+ * Create an allocator counting against a new counter
+ */
+template <class T>
+TrackingAllocator<T> NewTrackingAllocator() {
+	return TrackingAllocator<T>(std::make_shared<MemoryCounter>());
+}
+
+/**
+ * Create an allocator counting against a new pooled counter, for the
+ * containers of a structure built from many small nodes
+ */
+template <class T>
+TrackingAllocator<T> NewPooledAllocator() {
+	return TrackingAllocator<T>(std::make_shared<MemoryCounter>(true));
+}
+
+/**
+ * A MemoryReport gives the bytes used by each of a repository's
+ * structures. Memory held by entities themselves (such as strings),
+ * outside of the storage that holds them, isn't included.
+ */
+struct MemoryReport {
+	size_t              storage; // Entities, as stored
+	size_t              ids;     // Primary index
+	std::vector<size_t> indexes; // Secondary indexes, in the order they are declared
+
+	size_t Total() const {
+		return std::accumulate(indexes.begin(), indexes.end(), storage + ids);
+	}
+};
+
+};
+
+#endif
@@ -0,0 +1,384 @@
+#ifndef __METADATA_COLUMNS_HPP__
+#define __METADATA_COLUMNS_HPP__
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+#include <cstdint>
+
+#include "Document.hpp"
+#include "IdTable.hpp"
+#include "Serialization.hpp"
+
+namespace Database
+{
+
+/**
+ * MetadataColumns keeps the metadata of every document in columns: an
+ * array each of ids, publication times, titles and first authors, a row
+ * per document, so that a scan or sort over a field reads only that
+ * field's array rather than every document in turn.
+ *
+ * Titles are kept in one shared block of text, each row holding its
+ * title's offset and length; text left behind by changed and removed
+ * titles is reclaimed once it makes up half the block. First authors
+ * are kept as ids into a table of author names, assigned as the names
+ * are first seen. Removing a document moves the last row into its
+ * place, so row order is arbitrary.
+ *
+ * It is kept up to date by a Repository as one of its index policies,
+ * and named by itself when fetched (see Repository::GetIndex).
+ */
+class MetadataColumns
+{
+public:
+	typedef MetadataColumns Tag;
+	typedef bool            Snapshot; // Rows are rewritten in place
+
+	static const bool IsUnique = false;
+
+	static const size_t npos = static_cast<size_t>(-1);
+
+	// Where a title is in the shared text
+	struct TextRef {
+		uint32_t offset;
+		uint32_t length;
+	};
+
+	MetadataColumns() : garbage(0) {
+	}
+
+	// Author names are referred to by address, so the columns are moved
+	// but never copied
+	MetadataColumns(const MetadataColumns &) = delete;
+	MetadataColumns &operator=(const MetadataColumns &) = delete;
+	MetadataColumns(MetadataColumns &&) = default;
+	MetadataColumns &operator=(MetadataColumns &&) = default;
+
+	template <class T>
+	bool CanInsert(const T &, unsigned int) const {
+		return true;
+	}
+
+	void Insert(const Document &document, unsigned int id) {
+		rows.Insert(id, static_cast<uint32_t>(ids.size()));
+
+		ids.push_back(id);
+		published.push_back(static_cast<int64_t>(document.Published()));
+		titles.push_back(store(document.Title()));
+		authors.push_back(intern(document.Authors().empty() ? std::string() : document.Authors().front()));
+	}
+
+	void Erase(const Document &, unsigned int id) {
+		size_t row = Row(id);
+		if (row == npos) {
+			return;
+		}
+		garbage += titles[row].length;
+
+		// Fill the hole with the last row
+		size_t last = ids.size() - 1;
+		ids[row] = ids[last];
+		published[row] = published[last];
+		titles[row] = titles[last];
+		authors[row] = authors[last];
+		*rows.Find(ids[row]) = static_cast<uint32_t>(row);
+		rows.Erase(id);
+
+		ids.pop_back();
+		published.pop_back();
+		titles.pop_back();
+		authors.pop_back();
+		compact();
+	}
+
+	Snapshot Take(const Document &) const {
+		return true;
+	}
+
+	void Reindex(Snapshot, const Document &document, unsigned int id) {
+		size_t row = Row(id);
+		if (row == npos) {
+			return;
+		}
+
+		published[row] = static_cast<int64_t>(document.Published());
+		authors[row] = intern(document.Authors().empty() ? std::string() : document.Authors().front());
+		if (Title(row) != document.Title()) {
+			garbage += titles[row].length;
+			titles[row] = store(document.Title());
+			compact();
+		}
+	}
+
+	/**
+	 * Hash combines the fields held, for fingerprinting (see Repository)
+	 */
+	static uint64_t Hash(const Document &document) {
+		int64_t time = static_cast<int64_t>(document.Published());
+		uint64_t hash = Checksum(reinterpret_cast<const char*>(&time), sizeof(time));
+		hash = Checksum(document.Title().data(), document.Title().size(), hash * 31 + 17);
+		if (!document.Authors().empty()) {
+			hash = Checksum(document.Authors().front().data(), document.Authors().front().size(), hash * 31 + 17);
+		}
+		return hash;
+	}
+
+	/**
+	 * Return the number of rows, one per document
+	 */
+	size_t Size() const {
+		return ids.size();
+	}
+
+	/**
+	 * Return the row of a document, or npos if it has none
+	 */
+	size_t Row(unsigned int id) const {
+		const uint32_t *row = rows.Find(id);
+		return row != nullptr ? static_cast<size_t>(*row) : static_cast<size_t>(npos);
+	}
+
+	// The columns, indexed by row
+	const std::vector<unsigned int> &Ids() const {
+		return ids;
+	}
+
+	const std::vector<int64_t> &Published() const {
+		return published;
+	}
+
+	const std::vector<TextRef> &Titles() const {
+		return titles;
+	}
+
+	const std::vector<uint32_t> &FirstAuthors() const {
+		return authors;
+	}
+
+	/**
+	 * Return the title of a row
+	 */
+	std::string Title(size_t row) const {
+		return text.substr(titles[row].offset, titles[row].length);
+	}
+
+	/**
+	 * CompareTitles compares the titles of two rows as std::string
+	 * does, without copying them out
+	 */
+	int CompareTitles(size_t a, size_t b) const {
+		const TextRef &x = titles[a], &y = titles[b];
+		int result = std::memcmp(text.data() + x.offset, text.data() + y.offset, std::min(x.length, y.length));
+		return result != 0 ? result : (x.length < y.length ? -1 : x.length > y.length ? 1 : 0);
+	}
+
+	/**
+	 * Return the name of an author id
+	 */
+	const std::string &AuthorName(uint32_t author) const {
+		return *names[author];
+	}
+
+	/**
+	 * AuthorRanks returns the position of each author id among the
+	 * names in order, so that first authors can be sorted by comparing
+	 * integers
+	 */
+	std::vector<uint32_t> AuthorRanks() const {
+		std::vector<uint32_t> order(names.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+			return *names[a] < *names[b];
+		});
+
+		std::vector<uint32_t> ranks(names.size());
+		for (size_t i = 0; i < order.size(); ++i) {
+			ranks[order[i]] = static_cast<uint32_t>(i);
+		}
+		return ranks;
+	}
+
+	/**
+	 * PublishedBetween returns the ids of the documents published from
+	 * one time up to (but not including) another, in row order
+	 */
+	std::vector<unsigned int> PublishedBetween(int64_t from, int64_t to) const {
+		std::vector<unsigned int> found;
+		const int64_t *times = published.data();
+		for (size_t row = 0, count = published.size(); row < count; ++row) {
+			if (times[row] >= from && times[row] < to) {
+				found.push_back(ids[row]);
+			}
+		}
+		return found;
+	}
+
+	/**
+	 * Save writes the columns, the shared text and the author names
+	 */
+	void Save(BinaryWriter &writer) const {
+		std::string authorText;
+		std::vector<TextRef> authorRefs;
+		for (auto name : names) {
+			TextRef ref = { static_cast<uint32_t>(authorText.size()), static_cast<uint32_t>(name->size()) };
+			authorText += *name;
+			authorRefs.push_back(ref);
+		}
+
+		writer.Write<uint64_t>(ids.size());
+		writer.WriteArray(ids.data(), ids.size());
+		writer.WriteArray(published.data(), published.size());
+		writer.WriteArray(titles.data(), titles.size());
+		writer.WriteArray(authors.data(), authors.size());
+		writer.Write<uint64_t>(text.size());
+		writer.WriteArray(text.data(), text.size());
+		writer.Write<uint64_t>(authorRefs.size());
+		writer.WriteArray(authorRefs.data(), authorRefs.size());
+		writer.Write<uint64_t>(authorText.size());
+		writer.WriteArray(authorText.data(), authorText.size());
+	}
+
+	/**
+	 * Load replaces the columns with those written by Save
+	 */
+	bool Load(BinaryReader &reader) {
+		Clear();
+
+		uint64_t count = 0, textLength = 0, authorCount = 0, authorLength = 0;
+		const unsigned int *savedIds = nullptr;
+		const int64_t *savedPublished = nullptr;
+		const TextRef *savedTitles = nullptr, *savedAuthorRefs = nullptr;
+		const uint32_t *savedAuthors = nullptr;
+		const char *savedText = nullptr, *savedAuthorText = nullptr;
+
+		if (!reader.Read(count) ||
+		    (savedIds = reader.ReadArray<unsigned int>(static_cast<size_t>(count))) == nullptr ||
+		    (savedPublished = reader.ReadArray<int64_t>(static_cast<size_t>(count))) == nullptr ||
+		    (savedTitles = reader.ReadArray<TextRef>(static_cast<size_t>(count))) == nullptr ||
+		    (savedAuthors = reader.ReadArray<uint32_t>(static_cast<size_t>(count))) == nullptr ||
+		    !reader.Read(textLength) ||
+		    (savedText = reader.ReadArray<char>(static_cast<size_t>(textLength))) == nullptr ||
+		    !reader.Read(authorCount) ||
+		    (savedAuthorRefs = reader.ReadArray<TextRef>(static_cast<size_t>(authorCount))) == nullptr ||
+		    !reader.Read(authorLength) ||
+		    (savedAuthorText = reader.ReadArray<char>(static_cast<size_t>(authorLength))) == nullptr) {
+			return false;
+		}
+
+		for (size_t i = 0; i < authorCount; ++i) {
+			const TextRef &ref = savedAuthorRefs[i];
+			if (static_cast<uint64_t>(ref.offset) + ref.length > authorLength) {
+				Clear();
+				return false;
+			}
+			intern(std::string(savedAuthorText + ref.offset, ref.length));
+		}
+
+		text.assign(savedText, static_cast<size_t>(textLength));
+		for (size_t row = 0; row < count; ++row) {
+			const TextRef &title = savedTitles[row];
+			unsigned int id = savedIds[row];
+			if (static_cast<uint64_t>(title.offset) + title.length > textLength || savedAuthors[row] >= names.size() || Row(id) != npos) {
+				Clear();
+				return false;
+			}
+
+			rows.Insert(id, static_cast<uint32_t>(row));
+		}
+
+		ids.assign(savedIds, savedIds + count);
+		published.assign(savedPublished, savedPublished + count);
+		titles.assign(savedTitles, savedTitles + count);
+		authors.assign(savedAuthors, savedAuthors + count);
+
+		// The shared text is saved as it was, with any garbage
+		uint64_t live = 0;
+		for (auto &title : titles) {
+			live += title.length;
+		}
+		garbage = static_cast<size_t>(textLength - std::min(live, textLength));
+		return true;
+	}
+
+	/**
+	 * Return the bytes allocated for the columns and text
+	 */
+	size_t MemoryUsage() const {
+		size_t bytes = rows.MemoryUsage() + ids.capacity() * sizeof(unsigned int) +
+		               published.capacity() * sizeof(int64_t) + titles.capacity() * sizeof(TextRef) +
+		               authors.capacity() * sizeof(uint32_t) + text.capacity() + names.capacity() * sizeof(const std::string*);
+		for (auto &author : authorIds) {
+			bytes += sizeof(author) + author.first.capacity();
+		}
+		return bytes;
+	}
+
+	/**
+	 * Clear empties the columns
+	 */
+	void Clear() {
+		*this = MetadataColumns();
+	}
+
+private:
+	// Append a title to the shared text
+	TextRef store(const std::string &title) {
+		TextRef ref = { static_cast<uint32_t>(text.size()), static_cast<uint32_t>(title.size()) };
+		text += title;
+		return ref;
+	}
+
+	// Return the id of an author's name, assigning one if it's new
+	uint32_t intern(const std::string &name) {
+		auto found = authorIds.find(name);
+		if (found != authorIds.end()) {
+			return found->second;
+		}
+
+		uint32_t id = static_cast<uint32_t>(names.size());
+		auto added = authorIds.emplace(name, id).first;
+		names.push_back(&added->first);
+		return id;
+	}
+
+	// Copy the live titles to fresh text, once half of it is garbage
+	void compact() {
+		if (garbage < 4096 || garbage < text.size() / 2) {
+			return;
+		}
+
+		std::string live;
+		live.reserve(text.size() - garbage);
+		for (auto &title : titles) {
+			uint32_t offset = static_cast<uint32_t>(live.size());
+			live.append(text, title.offset, title.length);
+			title.offset = offset;
+		}
+		text.swap(live);
+		garbage = 0;
+	}
+
+private:
+	IdTable<uint32_t> rows; // By id
+
+	// Columns, by row
+	std::vector<unsigned int> ids;
+	std::vector<int64_t>      published;
+	std::vector<TextRef>      titles;
+	std::vector<uint32_t>     authors;
+
+	std::string text;    // Titles
+	size_t      garbage; // Bytes of text no longer referred to
+
+	// Author names, by id. The names are kept by the map.
+	std::unordered_map<std::string, uint32_t> authorIds;
+	std::vector<const std::string*>           names;
+};
+
+};
+
+#endif
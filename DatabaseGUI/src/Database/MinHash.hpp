@@ -0,0 +1,147 @@
+#ifndef __MIN_HASH_HPP__
+#define __MIN_HASH_HPP__
+
+#include <array>
+#include <string>
+#include <cstdint>
+#include <cctype>
+
+#include "Serialization.hpp"
+
+namespace Database
+{
+
+/**
+ * MinHash estimates how alike two texts are from short signatures.
+ *
+ * A text is broken into shingles, each a run of consecutive words (in
+ * lower case, ignoring punctuation), and its signature holds the least
+ * hash of any shingle under each of a number of hash functions. The
+ * fraction of slots in which two signatures agree estimates the Jaccard
+ * similarity of the texts' shingles.
+ *
+ * Signatures are also split into bands, and each band hashed to a key
+ * (locality-sensitive hashing), so that similar texts can be found
+ * through an index of band keys: texts share a band key with a chance
+ * that rises steeply with their similarity. With 8 bands of 4 slots,
+ * a pair of texts that are 80% alike shares a key 98% of the time,
+ * and a pair 30% alike only 6% of the time.
+ */
+class MinHash
+{
+public:
+	enum {
+		Hashes       = 32,
+		Bands        = 8,
+		Rows         = Hashes / Bands,
+		ShingleWords = 3
+	};
+
+	typedef std::array<uint64_t, Hashes> Signature;
+
+	/**
+	 * Sign returns the signature of a text. A text with fewer words than
+	 * a shingle is taken as a single shingle, and a text without any
+	 * words has an empty signature (see IsEmpty).
+	 */
+	static Signature Sign(const std::string &text) {
+		Signature signature;
+		signature.fill(empty());
+
+		uint64_t window[ShingleWords] = {};
+		size_t words = 0;
+
+		uint64_t word = Checksum(nullptr, 0);
+		bool inWord = false;
+		for (size_t i = 0; i <= text.size(); ++i) {
+			unsigned char c = i < text.size() ? static_cast<unsigned char>(text[i]) : ' ';
+			if (c >= 0x80 || std::isalnum(c)) {
+				char lower = static_cast<char>(std::tolower(c));
+				word = Checksum(&lower, 1, word);
+				inWord = true;
+			} else if (inWord) {
+				window[words % ShingleWords] = word;
+				if (++words >= ShingleWords) {
+					add(signature, shingle(window, words, ShingleWords));
+				}
+				word = Checksum(nullptr, 0);
+				inWord = false;
+			}
+		}
+
+		if (words > 0 && words < ShingleWords) {
+			add(signature, shingle(window, words, words));
+		}
+		return signature;
+	}
+
+	/**
+	 * Return whether a signature is of a text without any words
+	 */
+	static bool IsEmpty(const Signature &signature) {
+		return signature[0] == empty();
+	}
+
+	/**
+	 * Similarity estimates the Jaccard similarity of two texts from their
+	 * signatures, between 0 and 1. Texts without words are like nothing.
+	 */
+	static double Similarity(const Signature &a, const Signature &b) {
+		if (IsEmpty(a) || IsEmpty(b)) {
+			return 0;
+		}
+
+		size_t same = 0;
+		for (size_t i = 0; i < Hashes; ++i) {
+			same += a[i] == b[i];
+		}
+		return static_cast<double>(same) / Hashes;
+	}
+
+	/**
+	 * BandKeys calls func(key) with the key of each of a signature's bands
+	 */
+	template <class Func>
+	static void BandKeys(const Signature &signature, Func func) {
+		for (uint64_t band = 0; band < Bands; ++band) {
+			uint64_t key = Checksum(reinterpret_cast<const char*>(&band), sizeof(band));
+			key = Checksum(reinterpret_cast<const char*>(&signature[band * Rows]), Rows * sizeof(uint64_t), key);
+			func(key);
+		}
+	}
+
+private:
+	// Value of every slot of an empty signature
+	static uint64_t empty() {
+		return ~uint64_t(0);
+	}
+
+	// Combine the hashes of the last count words into a shingle's hash
+	static uint64_t shingle(const uint64_t *window, size_t words, size_t count) {
+		uint64_t hash = Checksum(nullptr, 0);
+		for (size_t j = words - count; j < words; ++j) {
+			hash = Checksum(reinterpret_cast<const char*>(&window[j % ShingleWords]), sizeof(uint64_t), hash);
+		}
+		return hash;
+	}
+
+	// Lower each slot of a signature to the shingle's hash under that
+	// slot's hash function, if it is less. The functions are SplitMix64
+	// finalisers of the shingle's hash, offset differently for each slot.
+	static void add(Signature &signature, uint64_t hash) {
+		for (size_t i = 0; i < Hashes; ++i) {
+			uint64_t x = hash + (i + 1) * 0x9E3779B97F4A7C15ull;
+			x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+			x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+			x ^= x >> 31;
+
+			if (x < signature[i]) {
+				signature[i] = x;
+			}
+		}
+	}
+};
+
+};
+
+#endif
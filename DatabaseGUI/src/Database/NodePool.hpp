@@ -0,0 +1,126 @@
+#ifndef __NODE_POOL_HPP__
+#define __NODE_POOL_HPP__
+
+#include <vector>
+#include <new>
+#include <cstddef>
+#include <cstdint>
+
+namespace Database
+{
+
+/**
+ * The NodePool hands out the small blocks that node-based containers
+ * allocate one at a time (list and tree nodes, short posting lists),
+ * carving them from large chunks instead of calling the heap for each.
+ * Nodes allocated one after another sit next to each other in memory,
+ * and a freed block is kept on a free list for its size, to be reused
+ * by the next allocation of that size.
+ *
+ * Blocks larger than Largest go to the heap as usual. The chunks are
+ * only returned to the heap when the pool is destroyed, which frees
+ * them all at once rather than block by block.
+ *
+ * A pool isn't synchronised: it belongs to a single structure, which
+ * is changed by one thread at a time.
+ */
+class NodePool
+{
+public:
+	enum {
+		Alignment  = 16,         // Of every block, and the step between block sizes
+		Largest    = 256,        // Largest block taken from a chunk
+		FirstChunk = 4 * 1024,   // Chunks start small, for small structures,
+		LastChunk  = 256 * 1024  // and double up to this
+	};
+
+	NodePool() : cursor(nullptr), remaining(0), nextChunk(FirstChunk), reserved(0) {
+		for (auto &list : free) {
+			list = nullptr;
+		}
+	}
+
+	~NodePool() {
+		for (void *chunk : chunks) {
+			::operator delete(chunk);
+		}
+	}
+
+	NodePool(const NodePool &) = delete;
+	NodePool &operator=(const NodePool &) = delete;
+
+	void *Allocate(size_t bytes) {
+		if (bytes == 0 || bytes > Largest) {
+			return ::operator new(bytes);
+		}
+
+		size_t sizeClass = (bytes - 1) / Alignment;
+		if (free[sizeClass] != nullptr) {
+			Block *block = free[sizeClass];
+			free[sizeClass] = block->next;
+			return block;
+		}
+
+		size_t size = (sizeClass + 1) * Alignment;
+		if (remaining < size) {
+			grow();
+		}
+		void *block = cursor;
+		cursor += size;
+		remaining -= size;
+		return block;
+	}
+
+	void Deallocate(void *memory, size_t bytes) {
+		if (bytes == 0 || bytes > Largest) {
+			::operator delete(memory);
+			return;
+		}
+
+		size_t sizeClass = (bytes - 1) / Alignment;
+		Block *block = static_cast<Block*>(memory);
+		block->next = free[sizeClass];
+		free[sizeClass] = block;
+	}
+
+	/**
+	 * Return the bytes held in chunks, whether in use or not
+	 */
+	size_t Reserved() const {
+		return reserved;
+	}
+
+private:
+	struct Block {
+		Block *next;
+	};
+
+	// Start a new chunk. What's left of the last is too small to use.
+	// The heap may only align to 8 bytes (as on 32-bit Windows), so the
+	// chunk is allocated with room to start its blocks on Alignment.
+	void grow() {
+		char *chunk = static_cast<char*>(::operator new(nextChunk + Alignment));
+		chunks.push_back(chunk);
+
+		size_t misalignment = static_cast<size_t>(reinterpret_cast<uintptr_t>(chunk) % Alignment);
+		cursor = chunk + (misalignment != 0 ? Alignment - misalignment : 0);
+		remaining = nextChunk;
+		reserved += nextChunk + Alignment;
+		if (nextChunk < LastChunk) {
+			nextChunk *= 2;
+		}
+	}
+
+private:
+	Block *free[Largest / Alignment]; // By size class
+	char  *cursor;                    // Next unused byte of the current chunk
+	size_t remaining;
+
+	std::vector<void*> chunks;
+	size_t             nextChunk;
+	size_t             reserved;
+};
+
+};
+
+#endif
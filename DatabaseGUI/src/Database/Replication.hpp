@@ -0,0 +1,323 @@
+#ifndef __REPLICATION_HPP__
+#define __REPLICATION_HPP__
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <istream>
+#include <ostream>
+#include <chrono>
+#include <cstdint>
+
+#include "ResearchDocumentRepository.hpp"
+#include "Serialization.hpp"
+
+namespace Database
+{
+
+// Current time in milliseconds since the epoch, comparable between processes
+inline int64_t ReplicationClock() {
+	using namespace std::chrono;
+	return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * A ChangeRecord is a single change to a repository, as carried by a
+ * change feed. Records are numbered in the order the changes were made,
+ * starting from 1, and stamped with the time they were made.
+ */
+struct ChangeRecord
+{
+	typedef ResearchDocumentRepository::Change Change;
+
+	uint64_t sequence;
+	int64_t  timestamp; // Milliseconds since the epoch
+	Change   change;
+	Document document;  // Only the id is meaningful for removals
+
+	// Longest record read, so that a damaged length isn't allocated or
+	// waited for
+	enum { MaxLength = 256 * 1024 * 1024 };
+
+	ChangeRecord() : sequence(0), timestamp(0), change(Change::Added), document(0, "", "", "") {
+	}
+
+	/**
+	 * Write the record to a stream, as its length and checksum followed
+	 * by its contents
+	 */
+	void Write(std::ostream &out) const {
+		BinaryWriter payload;
+		payload.Write(sequence);
+		payload.Write(timestamp);
+		payload.Write(static_cast<uint8_t>(change));
+		payload.Write<uint32_t>(document.Id());
+
+		if (change != Change::Removed) {
+			payload.Write<int64_t>(document.Published());
+			payload.WriteString(document.Title());
+			payload.WriteString(document.Body());
+			payload.Write<uint32_t>(static_cast<uint32_t>(document.Authors().size()));
+			for (auto &author : document.Authors()) {
+				payload.WriteString(author);
+			}
+		}
+
+		const std::string &bytes = payload.Buffer();
+		uint32_t length = static_cast<uint32_t>(bytes.size());
+		uint64_t checksum = Checksum(bytes.data(), bytes.size());
+		out.write(reinterpret_cast<const char*>(&length), sizeof(length));
+		out.write(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+		out.write(bytes.data(), bytes.size());
+	}
+
+	/**
+	 * Read the next record from a stream.
+	 *
+	 * Returns false if a whole record isn't available yet, in which case
+	 * the stream is left where the record starts (if it can seek), so
+	 * that reading can be retried once more has been written. Sets
+	 * corrupt if the record was available but is damaged, or claims to
+	 * be longer than MaxLength.
+	 */
+	bool Read(std::istream &in, bool &corrupt) {
+		corrupt = false;
+		std::streampos start = in.tellg();
+
+		uint32_t length = 0;
+		uint64_t checksum = 0;
+		std::string bytes;
+		if (in.read(reinterpret_cast<char*>(&length), sizeof(length)) &&
+		    in.read(reinterpret_cast<char*>(&checksum), sizeof(checksum))) {
+			if (length > MaxLength) {
+				corrupt = true;
+				return false;
+			}
+			bytes.resize(length);
+			in.read(&bytes[0], length);
+		}
+
+		if (!in) {
+			// Incomplete, so rewind for another try
+			in.clear();
+			if (start != std::streampos(-1)) {
+				in.seekg(start);
+			}
+			return false;
+		}
+
+		if (Checksum(bytes.data(), bytes.size()) != checksum) {
+			corrupt = true;
+			return false;
+		}
+
+		BinaryReader payload(bytes.data(), bytes.size());
+		uint8_t kind = 0;
+		uint32_t id = 0;
+		payload.Read(sequence);
+		payload.Read(timestamp);
+		payload.Read(kind);
+		payload.Read(id);
+		change = static_cast<Change>(kind);
+
+		document = Document(id, "", "", "");
+		if (change != Change::Removed) {
+			int64_t published = 0;
+			std::string title, body;
+			uint32_t authors = 0;
+			payload.Read(published);
+			payload.ReadString(title);
+			payload.ReadString(body);
+			payload.Read(authors);
+
+			document.SetPublished(static_cast<std::time_t>(published));
+			document.SetTitle(std::move(title));
+			document.SetBody(std::move(body));
+			document.Authors().clear();
+			for (uint32_t i = 0; i < authors && !payload.Failed(); ++i) {
+				std::string author;
+				payload.ReadString(author);
+				document.Authors().push_back(std::move(author));
+			}
+		}
+
+		corrupt = payload.Failed() || kind > static_cast<uint8_t>(Change::Updated);
+		return !corrupt;
+	}
+};
+
+/**
+ * The ChangeFeed writes every change made to a repository to a stream
+ * (a file or pipe), as numbered ChangeRecords, for followers to apply.
+ *
+ * The feed starts with a record adding each document already stored,
+ * so that a follower starting from an empty repository catches up.
+ * The feed must be destroyed before the repository.
+ */
+class ChangeFeed
+{
+public:
+	ChangeFeed(ResearchDocumentRepository &repository, std::ostream &out) : repository(repository), out(out), sequence(0) {
+		for (auto &document : repository.FindAll()) {
+			write(ChangeRecord::Change::Added, document);
+		}
+		out.flush();
+
+		handle = repository.Listen([this](ChangeRecord::Change change, const Document &document) {
+			write(change, document);
+			this->out.flush();
+		});
+	}
+
+	~ChangeFeed() {
+		repository.Unlisten(handle);
+	}
+
+	ChangeFeed(const ChangeFeed &) = delete;
+	ChangeFeed &operator=(const ChangeFeed &) = delete;
+
+	/**
+	 * Return the sequence number of the last record written
+	 */
+	uint64_t Sequence() const {
+		return sequence;
+	}
+
+private:
+	void write(ChangeRecord::Change change, const Document &document) {
+		ChangeRecord record;
+		record.sequence = ++sequence;
+		record.timestamp = ReplicationClock();
+		record.change = change;
+		record.document = document;
+		record.Write(out);
+	}
+
+private:
+	ResearchDocumentRepository &repository;
+	std::ostream &out;
+	uint64_t sequence;
+	unsigned int handle;
+};
+
+/**
+ * The ReplicationFollower applies a change feed to a read-only copy of
+ * a repository, in another process.
+ *
+ * Poll applies whatever records have been written so far. On a file,
+ * it returns as soon as it reaches the end of what has been written; on
+ * a pipe, reading blocks until the next record arrives, so a pipe must
+ * only be polled from a worker thread. Pending reads ahead without
+ * applying, for readers of the repository to be stopped only when it
+ * is about to change.
+ */
+class ReplicationFollower
+{
+public:
+	/**
+	 * Replication progress, for reporting lag
+	 */
+	struct Status {
+		uint64_t                  applied;     // Sequence number of the last record applied
+		int64_t                   lastWritten; // When that record was written by the primary
+		std::chrono::milliseconds lag;         // Since that record was written, as of Progress
+		bool                      failed;
+	};
+
+	ReplicationFollower(ResearchDocumentRepository &repository, std::istream &in) : repository(repository), in(in), corrupt(false) {
+		status.applied = 0;
+		status.lastWritten = 0;
+		status.lag = std::chrono::milliseconds(0);
+		status.failed = false;
+	}
+
+	/**
+	 * Poll applies every complete record available, stopping at the
+	 * first that is damaged, out of sequence, or can't be applied, after
+	 * which the follower has failed and must be restarted from a new feed.
+	 *
+	 * Returns the number of records applied.
+	 */
+	size_t Poll() {
+		size_t count = 0;
+
+		Pending();
+		while (!status.failed && !pending.empty()) {
+			ChangeRecord &record = pending.front();
+			if (record.sequence != status.applied + 1 || !apply(record)) {
+				status.failed = true;
+				break;
+			}
+
+			status.applied = record.sequence;
+			status.lastWritten = record.timestamp;
+			pending.pop_front();
+			++count;
+		}
+
+		if (corrupt) {
+			status.failed = true;
+		}
+		return count;
+	}
+
+	/**
+	 * Pending reads every complete record available, to be applied by
+	 * the next Poll, and returns whether that Poll has anything to do
+	 */
+	bool Pending() {
+		while (!status.failed && !corrupt) {
+			ChangeRecord record;
+			if (!record.Read(in, corrupt)) {
+				break;
+			}
+			pending.push_back(std::move(record));
+		}
+		return !status.failed && (!pending.empty() || corrupt);
+	}
+
+	/**
+	 * Return the progress so far, the lag being measured up to now
+	 */
+	Status Progress() const {
+		Status progress = status;
+		if (progress.applied > 0) {
+			progress.lag = std::chrono::milliseconds(ReplicationClock() - progress.lastWritten);
+		}
+		return progress;
+	}
+
+private:
+	bool apply(ChangeRecord &record) {
+		unsigned int id = record.document.Id();
+
+		switch (record.change) {
+		case ChangeRecord::Change::Added:
+			return repository.Add(std::move(record.document));
+
+		case ChangeRecord::Change::Removed: {
+			auto found = repository.FindOneById(id);
+			return found != nullptr && repository.Remove(*found);
+		}
+
+		case ChangeRecord::Change::Updated:
+			return repository.Update(id, [&](Document &stored) {
+				stored = std::move(record.document);
+			});
+		}
+		return false;
+	}
+
+private:
+	ResearchDocumentRepository &repository;
+	std::istream &in;
+	Status status;
+
+	// Records read ahead of being applied, see Pending
+	std::deque<ChangeRecord> pending;
+	bool                     corrupt;
+};
+
+};
+
+#endif
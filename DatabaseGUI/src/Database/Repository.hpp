@@ -1,70 +1,867 @@
-#ifndef __REPOSITORY_HPP__
-#define __REPOSITORY_HPP__
-
-#include <list>
-
-namespace Database
-{
-
-/**
- * The repository class is a base class that implements a storage area
- * and iterator for a collection of entities.
- *
- * The add and remove methods are expected to be implemented via a child
- * class, a repository handling a specific entity. This repository will
- * also index said entity if required.
- */
-template <class T>
-class Repository {
-public:
-	/**
-	 * Iterator class used for iteration over the stored entities
-	 */
-	class Iterator
-	{
-		unsigned int index;
-		const Repository<T> *repo;
-
-	public:
-		Iterator(const Repository<T> *repo, unsigned int index) : repo(repo), index(index) {
-		}
- 
-		bool operator!=(const Iterator &other) const {
-			return index != other.index;
-		}
- 
-		Iterator operator++() {
-			++index;
-			return *this;
-		}
- 
-		const T *operator->() const {
-			return &repo->storage.at(index);
-		}
- 
-		const T &operator*() const {
-			return repo->storage.at(index);
-		}
-	};
-
-	virtual bool Add(const T &item) = 0;
-	virtual bool Remove(const T &item) = 0;
-	
-	Iterator Begin() const {
-		// Start of iterator
-		return Iterator(this, 0);
-	}
- 
-	Iterator End() const {
-		// End of iterator
-		return Iterator(this, storage.size());
-	}
- 
-protected:
-	friend class Iterator;
-	std::list<T> storage;
-};
-
-};
-
+#ifndef __REPOSITORY_HPP__
+#define __REPOSITORY_HPP__
+
+#include <list>
+#include <vector>
+#include <tuple>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <string>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <array>
+#include <future>
+#include <chrono>
+
+#include "IdTable.hpp"
+#include "IdSet.hpp"
+#include "Index.hpp"
+#include "ResultView.hpp"
+#include "Serialization.hpp"
+#include "MemoryAccounting.hpp"
+#include "Trace.hpp"
+
+namespace Database
+{
+
+/**
+ * The repository class is a base class that implements a storage area
+ * and iterator for a collection of entities.
+ *
+ * Entities are indexed by their unique id, and by each of the index
+ * policies the repository is given (see Index). Adding, removing and
+ * updating an entity maintains every index, and FindManyBy<Extractor>
+ * queries the index named by that extractor; all of which is generated
+ * at compile time. A child class, a repository handling a specific
+ * entity, chooses the indexes and can add queries of its own.
+ *
+ * The secondary indexes can be saved to a file and loaded back on a
+ * later run instead of being rebuilt (see SaveIndexes and LoadIndexes),
+ * or built on worker threads while the entities are already available
+ * in storage order (see BuildIndexesInBackground).
+ *
+ * Listeners can be registered to be told of every change made, in the
+ * order it was made (see Listen).
+ *
+ * The number of entities under each key of an index is given by Facet.
+ *
+ * The memory used by storage and each index is reported by Memory.
+ * Entities are stored in list nodes allocated from a NodePool of the
+ * repository's own, so that they sit together in memory.
+ *
+ * Changes, queries and index maintenance are timed by TraceSpans (see
+ * Trace) while tracing is enabled.
+ *
+ * The entity type must provide Id() and SetId() methods.
+ */
+template <class T, class... Indexes>
+class Repository {
+	typedef std::list<T, TrackingAllocator<T>> Storage;
+	typedef typename Storage::iterator         Position;
+
+	// Version of the saved index layout, to be incremented when it changes
+	static const uint32_t IndexFileVersion = 2;
+
+	// Start of a saved index file, followed by each index in turn
+	struct IndexFileHeader {
+		char     magic[4];
+		uint32_t version;
+		uint64_t hashProbe;       // Detects a change of hash function
+		uint64_t fingerprint;     // Of the entities the indexes were built from
+		uint64_t entities;
+		uint64_t payloadLength;
+		uint64_t payloadChecksum;
+	};
+
+	// Projections from storage and index iterators to entities
+	struct StorageProjection {
+		const T &operator()(typename Storage::const_iterator it) const {
+			return *it;
+		}
+	};
+
+	struct IndexProjection {
+		const IdTable<Position> *ids;
+
+		const T &operator()(const unsigned int *it) const {
+			return **ids->Find(*it);
+		}
+	};
+
+	// Find the index policy named by an extractor
+	template <class Extractor, class... Rest>
+	struct IndexFor;
+
+	template <class Extractor, class First, class... Rest>
+	struct IndexFor<Extractor, First, Rest...> {
+		typedef typename std::conditional<
+			std::is_same<typename First::Tag, Extractor>::value,
+			First,
+			typename IndexFor<Extractor, Rest...>::Type
+		>::type Type;
+	};
+
+	template <class Extractor>
+	struct IndexFor<Extractor> {
+		typedef void Type;
+	};
+
+public:
+	// Kinds of change reported to listeners
+	enum class Change { Added, Removed, Updated };
+
+	typedef std::function<void(Change, const T&)> Listener;
+
+	// Views of query results, see ResultView
+	typedef ResultView<typename Storage::const_iterator, StorageProjection> View;
+	typedef ResultView<const unsigned int*, IndexProjection>               IndexView;
+
+	/**
+	 * Iterator class used for iteration over the stored entities
+	 */
+	class Iterator
+	{
+		typename Storage::const_iterator it;
+
+	public:
+		Iterator(typename Storage::const_iterator it) : it(it) {
+		}
+
+		bool operator!=(const Iterator &other) const {
+			return it != other.it;
+		}
+
+		Iterator operator++() {
+			++it;
+			return *this;
+		}
+
+		const T *operator->() const {
+			return &*it;
+		}
+
+		const T &operator*() const {
+			return *it;
+		}
+	};
+
+	Iterator Begin() const {
+		// Start of iterator
+		return Iterator(storage.begin());
+	}
+
+	Iterator End() const {
+		// End of iterator
+		return Iterator(storage.end());
+	}
+
+	/**
+	 * The add method takes an entity by reference, but creates
+	 * a copy of it for storage.
+	 *
+	 * This method returns true on success, false on failure.
+	 */
+	bool Add(const T &item) {
+		waitForIndexes();
+
+		// Check before copying, as the copy may be large
+		if (!canInsert(item)) {
+			return false;
+		}
+
+		return Add(T(item));
+	}
+
+	/**
+	 * Add an entity by moving it into storage.
+	 *
+	 * This method returns true on success, false if the id is already
+	 * in use or a unique index already holds one of its keys.
+	 */
+	bool Add(T &&item) {
+		TraceSpan span("Repository::Add");
+
+		waitForIndexes();
+		if (!canInsert(item)) {
+			return false;
+		}
+
+		// Store
+		storage.push_back(std::move(item));
+		index(std::prev(storage.end()));
+
+		return true;
+	}
+
+	/**
+	 * Emplace constructs an entity directly in storage from the
+	 * entity constructor's arguments.
+	 *
+	 * This method returns true on success, false on failure.
+	 */
+	template <class... Args>
+	bool Emplace(Args&&... args) {
+		TraceSpan span("Repository::Emplace");
+
+		waitForIndexes();
+		storage.emplace_back(std::forward<Args>(args)...);
+
+		if (!canInsert(storage.back())) {
+			storage.pop_back();
+			return false;
+		}
+
+		index(std::prev(storage.end()));
+
+		return true;
+	}
+
+	/**
+	 * The remove method takes an entity by reference and uses
+	 * its unique id to remove all indexes the repository contains
+	 * in relation to the entity, and then the copy of the entity itself.
+	 *
+	 * This method returns true if the entity was found and removed,
+	 * false if otherwise.
+	 */
+	bool Remove(const T &item) {
+		TraceSpan span("Repository::Remove");
+
+		waitForIndexes();
+
+		// The entity given may be the stored copy itself
+		unsigned int id = item.Id();
+
+		auto found = id_idx.Find(id);
+		if (found == nullptr) {
+			return false;
+		}
+
+		auto it = *found;
+
+		// Remove indexes
+		forEachIndex([&](auto &index) {
+			index.Erase(*it, id);
+		});
+		id_idx.Erase(id);
+		fingerprint ^= entityHash(*it);
+		notify(Change::Removed, *it);
+
+		// The id may now be handed out again
+		free_ids.push_back(id);
+
+		// Remove item
+		storage.erase(it);
+
+		return true;
+	}
+
+	/**
+	 * Update applies a mutation to the stored entity with the given
+	 * id, in place. Afterwards only the index entries for keys that
+	 * were changed by the mutation are updated.
+	 *
+	 * An entity's id can't be changed by an update. If the change would
+	 * break a unique index, the entity is restored and nothing changes.
+	 *
+	 * This method returns true if the entity was found and updated,
+	 * false if otherwise.
+	 */
+	bool Update(unsigned int id, std::function<void(T&)> mutation) {
+		TraceSpan span("Repository::Update");
+
+		waitForIndexes();
+		return update(id, mutation, std::index_sequence_for<Indexes...>());
+	}
+
+	/**
+	 * NextId returns an id that isn't in use, for a new entity.
+	 * Ids freed by Remove are reused before new ones are handed out.
+	 */
+	unsigned int NextId() {
+		// Skip freed ids that have since been used again
+		while (!free_ids.empty()) {
+			if (id_idx.Find(free_ids.back()) == nullptr) {
+				return free_ids.back();
+			}
+			free_ids.pop_back();
+		}
+		return next_id;
+	}
+
+	/**
+	 * Generation returns the number of times an entity with the given id
+	 * has been removed. Together the id and generation identify a single
+	 * entity, even when ids are reused.
+	 */
+	unsigned int Generation(unsigned int id) const {
+		return id_idx.Generation(id);
+	}
+
+	/**
+	 * Version returns a number that changes each time the entity with the
+	 * given id is added or updated. Together the id and version identify
+	 * a single state of an entity, for caching what is derived from it.
+	 */
+	unsigned int Version(unsigned int id) const {
+		return id_idx.Version(id);
+	}
+
+	/**
+	 * FindOneById finds a single entity by its
+	 * unique id, or else returns null.
+	 */
+	const T* FindOneById(unsigned int id) const {
+		auto found = id_idx.Find(id);
+		if (found == nullptr) {
+			return nullptr;
+		}
+
+		return &**found;
+	}
+
+	/**
+	 * FindAll returns a view of all entities currently
+	 * stored by the repository.
+	 */
+	View FindAll() const {
+		return View(storage.begin(), storage.end());
+	}
+
+	/**
+	 * FindManyBy returns a view of all entities with the given key in
+	 * the index named by the Extractor.
+	 */
+	template <class Extractor>
+	IndexView FindManyBy(const typename Extractor::Key &key) const {
+		TraceSpan span("Repository::FindManyBy");
+
+		return postings(GetIndex<Extractor>().Find(key));
+	}
+
+	/**
+	 * Facet counts the entities under each key of the index named by
+	 * the Extractor, in the index's order. A key's count is the length
+	 * of its postings, so counts are kept up to date by the index itself
+	 * and cost nothing to maintain.
+	 */
+	template <class Extractor>
+	std::vector<std::pair<typename Extractor::Key, size_t>> Facet() const {
+		TraceSpan span("Repository::Facet");
+
+		std::vector<std::pair<typename Extractor::Key, size_t>> counts;
+		GetIndex<Extractor>().Keys().ForEach([&](const typename Extractor::Key &key, const typename IndexFor<Extractor, Indexes...>::Type::Postings &ids) {
+			counts.emplace_back(key, ids.size());
+		});
+		return counts;
+	}
+
+	/**
+	 * Facet counts only the entities within a set, such as the results
+	 * of a query, by intersecting each key's postings with it. Keys
+	 * without any entities in the set are left out.
+	 */
+	template <class Extractor>
+	std::vector<std::pair<typename Extractor::Key, size_t>> Facet(const IdSet &within) const {
+		TraceSpan span("Repository::Facet");
+
+		std::vector<std::pair<typename Extractor::Key, size_t>> counts;
+		GetIndex<Extractor>().Keys().ForEach([&](const typename Extractor::Key &key, const typename IndexFor<Extractor, Indexes...>::Type::Postings &ids) {
+			size_t count = 0;
+			for (auto id : ids) {
+				count += within.Contains(id);
+			}
+			if (count > 0) {
+				counts.emplace_back(key, count);
+			}
+		});
+		return counts;
+	}
+
+	/**
+	 * TopKeys returns the k keys of the index named by the Extractor
+	 * with the most entities, most first (and in order of key when
+	 * tied), optionally counting only the entities within a set.
+	 *
+	 * Keys are kept in a heap of at most k, so this costs O(N log k)
+	 * for N keys, without counting or sorting every key up front.
+	 */
+	template <class Extractor>
+	std::vector<std::pair<typename Extractor::Key, size_t>> TopKeys(size_t k) const {
+		return topKeys<Extractor>(k, nullptr);
+	}
+
+	template <class Extractor>
+	std::vector<std::pair<typename Extractor::Key, size_t>> TopKeys(size_t k, const IdSet &within) const {
+		return topKeys<Extractor>(k, &within);
+	}
+
+	/**
+	 * Return the index policy named by the Extractor, first waiting for
+	 * it to be built if it is being built in the background.
+	 */
+	template <class Extractor>
+	const typename IndexFor<Extractor, Indexes...>::Type &GetIndex() const {
+		typedef typename IndexFor<Extractor, Indexes...>::Type Policy;
+		static_assert(!std::is_void<Policy>::value, "No index for this extractor");
+
+		auto &building = ready[position<Policy>()];
+		if (building.valid()) {
+			building.wait();
+		}
+		return std::get<Policy>(indexes);
+	}
+
+	/**
+	 * Memory reports the bytes allocated for storage and each index
+	 */
+	MemoryReport Memory() const {
+		MemoryReport report;
+		report.storage = storage.get_allocator().Bytes();
+		report.ids = id_idx.MemoryUsage();
+		forEachIndex([&](const auto &index) {
+			report.indexes.push_back(index.MemoryUsage());
+		});
+		return report;
+	}
+
+	/**
+	 * Listen registers a listener to be called after each change to the
+	 * repository, with the kind of change and the entity as it now is
+	 * (or was, if removed). Returns a handle for Unlisten.
+	 */
+	unsigned int Listen(Listener listener) {
+		listeners.emplace_back(++last_listener, std::move(listener));
+		return last_listener;
+	}
+
+	/**
+	 * Unlisten removes a listener registered by Listen
+	 */
+	void Unlisten(unsigned int handle) {
+		listeners.erase(std::remove_if(listeners.begin(), listeners.end(), [&](const std::pair<unsigned int, Listener> &listener) {
+			return listener.first == handle;
+		}), listeners.end());
+	}
+
+	/**
+	 * Return the number of stored entities
+	 */
+	size_t Size() const {
+		return id_idx.Size();
+	}
+
+	/**
+	 * DeferIndexing stops entities that are added from being put in the
+	 * secondary indexes, until LoadIndexes or RebuildIndexes is called.
+	 * This allows a large number of entities to be added quickly before
+	 * their saved indexes are loaded. Meanwhile, queries on the secondary
+	 * indexes, and unique index checks, don't see the added entities.
+	 */
+	void DeferIndexing() {
+		waitForIndexes();
+		deferred = true;
+	}
+
+	/**
+	 * BuildIndexesInBackground rebuilds every secondary index from
+	 * storage, each on a worker thread, and returns straight away.
+	 *
+	 * Entities can be read through FindAll, FindOneById and iteration
+	 * while the indexes are built. A query on an index waits until that
+	 * index is ready, and any change to the repository waits until they
+	 * all are.
+	 */
+	void BuildIndexesInBackground() {
+		waitForIndexes();
+		buildInBackground(std::index_sequence_for<Indexes...>());
+		deferred = false;
+	}
+
+	/**
+	 * IndexesReady returns false while indexes are still being built
+	 * in the background.
+	 */
+	bool IndexesReady() const {
+		return std::all_of(ready.begin(), ready.end(), [](const std::shared_future<void> &building) {
+			return !building.valid() || building.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+		});
+	}
+
+	/**
+	 * RebuildIndexes rebuilds every secondary index from storage
+	 */
+	void RebuildIndexes() {
+		TraceSpan span("Repository::RebuildIndexes");
+
+		waitForIndexes();
+		forEachIndex([&](auto &index) {
+			index.Clear();
+		});
+
+		for (auto &item : storage) {
+			forEachIndex([&](auto &index) {
+				index.Insert(item, item.Id());
+			});
+		}
+		deferred = false;
+	}
+
+	/**
+	 * Fingerprint identifies the stored entities' ids and indexed keys,
+	 * regardless of the order they were added in. Saved indexes are only
+	 * loaded for entities with the same fingerprint.
+	 */
+	uint64_t Fingerprint() const {
+		return fingerprint;
+	}
+
+	/**
+	 * SaveIndexes writes the secondary indexes to a file.
+	 *
+	 * This method returns true on success, false if the file couldn't
+	 * be written.
+	 */
+	bool SaveIndexes(const std::string &path) const {
+		TraceSpan span("Repository::SaveIndexes");
+
+		waitForIndexes();
+
+		BinaryWriter payload;
+		forEachIndex([&](const auto &index) {
+			index.Save(payload);
+		});
+
+		IndexFileHeader header = {};
+		std::memcpy(header.magic, "RDIX", sizeof(header.magic));
+		header.version = IndexFileVersion;
+		header.hashProbe = hashProbe();
+		header.fingerprint = fingerprint;
+		header.entities = Size();
+		header.payloadLength = payload.Buffer().size();
+		header.payloadChecksum = Checksum(payload.Buffer().data(), payload.Buffer().size());
+
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(payload.Buffer().data(), payload.Buffer().size());
+		return static_cast<bool>(file);
+	}
+
+	/**
+	 * LoadIndexes replaces the secondary indexes with those saved in a
+	 * file. If the file is missing, corrupt, of another version, or was
+	 * saved for different entities, the indexes are rebuilt from storage
+	 * instead.
+	 *
+	 * This method returns true if the saved indexes were loaded, false
+	 * if they had to be rebuilt.
+	 */
+	bool LoadIndexes(const std::string &path) {
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		std::streamoff length = file ? static_cast<std::streamoff>(file.tellg()) : 0;
+
+		// Read into 8-byte aligned memory, as the layout expects
+		std::vector<uint64_t> buffer(static_cast<size_t>(length + 7) / 8);
+		if (length > 0) {
+			file.seekg(0);
+			file.read(reinterpret_cast<char*>(buffer.data()), length);
+		}
+		if (!file || length <= 0) {
+			RebuildIndexes();
+			return false;
+		}
+
+		return LoadIndexes(reinterpret_cast<const char*>(buffer.data()), static_cast<size_t>(length));
+	}
+
+	/**
+	 * Load the secondary indexes from a saved file already in memory
+	 * (for example, memory mapped). The data must be 8-byte aligned.
+	 */
+	bool LoadIndexes(const char *data, size_t length) {
+		TraceSpan span("Repository::LoadIndexes");
+
+		waitForIndexes();
+
+		IndexFileHeader header;
+		if (length < sizeof(header)) {
+			RebuildIndexes();
+			return false;
+		}
+		std::memcpy(&header, data, sizeof(header));
+
+		const char *payload = data + sizeof(header);
+		bool valid = std::memcmp(header.magic, "RDIX", sizeof(header.magic)) == 0 &&
+			header.version == IndexFileVersion &&
+			header.hashProbe == hashProbe() &&
+			header.fingerprint == fingerprint &&
+			header.entities == Size() &&
+			header.payloadLength == length - sizeof(header) &&
+			header.payloadChecksum == Checksum(payload, length - sizeof(header));
+
+		if (valid) {
+			BinaryReader reader(payload, length - sizeof(header));
+			forEachIndex([&](auto &index) {
+				valid = valid && index.Load(reader);
+			});
+		}
+
+		if (!valid) {
+			RebuildIndexes();
+			return false;
+		}
+
+		deferred = false;
+		return true;
+	}
+
+protected:
+	// Create a view of the entities in a posting list, which may be null
+	template <class Postings>
+	IndexView postings(const Postings *ids) const {
+		IndexProjection projection = { &id_idx };
+		if (ids == nullptr || ids->empty()) {
+			return IndexView(nullptr, nullptr, projection);
+		}
+
+		return IndexView(ids->data(), ids->data() + ids->size(), projection);
+	}
+
+private:
+	// Call func with each index policy in turn
+	template <class Func>
+	void forEachIndex(Func func) {
+		forEachIndex(func, std::index_sequence_for<Indexes...>());
+	}
+
+	template <class Func, size_t... I>
+	void forEachIndex(Func &func, std::index_sequence<I...>) {
+		int expand[] = { 0, (func(std::get<I>(indexes)), 0)... };
+		(void)expand;
+	}
+
+	template <class Func>
+	void forEachIndex(Func func) const {
+		forEachIndex(func, std::index_sequence_for<Indexes...>());
+	}
+
+	template <class Func, size_t... I>
+	void forEachIndex(Func &func, std::index_sequence<I...>) const {
+		int expand[] = { 0, (func(std::get<I>(indexes)), 0)... };
+		(void)expand;
+	}
+
+	template <class Func>
+	bool allIndexes(Func func) const {
+		return allIndexes(func, std::index_sequence_for<Indexes...>());
+	}
+
+	template <class Func, size_t... I>
+	bool allIndexes(Func &func, std::index_sequence<I...>) const {
+		bool results[] = { true, func(std::get<I>(indexes))... };
+		return std::all_of(std::begin(results), std::end(results), [](bool result) { return result; });
+	}
+
+	// Keep the k keys with the most entities (within a set, if given) in
+	// a heap whose front is the weakest, so it can be replaced
+	template <class Extractor>
+	std::vector<std::pair<typename Extractor::Key, size_t>> topKeys(size_t k, const IdSet *within) const {
+		TraceSpan span("Repository::TopKeys");
+
+		typedef std::pair<typename Extractor::Key, size_t> Count;
+		typedef typename IndexFor<Extractor, Indexes...>::Type::Postings Postings;
+
+		auto stronger = [](const Count &a, const Count &b) {
+			return a.second > b.second || (a.second == b.second && a.first < b.first);
+		};
+
+		std::vector<Count> heap;
+		if (k == 0) {
+			return heap;
+		}
+
+		GetIndex<Extractor>().Keys().ForEach([&](const typename Extractor::Key &key, const Postings &ids) {
+			size_t count = ids.size();
+			if (within != nullptr) {
+				count = 0;
+				for (auto id : ids) {
+					count += within->Contains(id);
+				}
+			}
+			if (count == 0) {
+				return;
+			}
+
+			// Only copy the key if it will be kept
+			if (heap.size() < k) {
+				heap.emplace_back(key, count);
+				std::push_heap(heap.begin(), heap.end(), stronger);
+			} else if (count > heap.front().second || (count == heap.front().second && key < heap.front().first)) {
+				std::pop_heap(heap.begin(), heap.end(), stronger);
+				heap.back() = Count(key, count);
+				std::push_heap(heap.begin(), heap.end(), stronger);
+			}
+		});
+
+		std::sort_heap(heap.begin(), heap.end(), stronger);
+		return heap;
+	}
+
+	// Check an entity's id and unique keys aren't already in use
+	bool canInsert(const T &item) const {
+		if (id_idx.Find(item.Id()) != nullptr) {
+			return false;
+		}
+
+		return allIndexes([&](auto &index) {
+			return index.CanInsert(item, item.Id());
+		});
+	}
+
+	// Add a stored entity to the indexes
+	void index(Position it) {
+		unsigned int id = it->Id();
+
+		id_idx.Insert(id, it);
+		if (!deferred) {
+			forEachIndex([&](auto &index) {
+				index.Insert(*it, id);
+			});
+		}
+		fingerprint ^= entityHash(*it);
+		notify(Change::Added, *it);
+
+		// Keep new ids clear of those already used
+		next_id = std::max(next_id, id + 1);
+	}
+
+	template <size_t... I>
+	bool update(unsigned int id, std::function<void(T&)> &mutation, std::index_sequence<I...>) {
+		auto found = id_idx.Find(id);
+		if (found == nullptr) {
+			return false;
+		}
+
+		T &item = **found;
+
+		// Unique indexes may reject the change, so keep a copy to restore
+		const bool unique = isAnyUnique();
+		std::vector<T> backup;
+		if (unique) {
+			backup.push_back(item);
+		}
+
+		// Remember the indexed keys before the mutation
+		auto snapshots = std::make_tuple(std::get<I>(indexes).Take(item)...);
+		uint64_t hash = entityHash(item);
+
+		mutation(item);
+		item.SetId(id);
+
+		if (unique && !allIndexes([&](auto &index) { return index.CanInsert(item, id); })) {
+			item = std::move(backup.front());
+			return false;
+		}
+
+		// Re-index only the keys that changed
+		int expand[] = { 0, (std::get<I>(indexes).Reindex(std::move(std::get<I>(snapshots)), item, id), 0)... };
+		(void)expand;
+		fingerprint ^= hash ^ entityHash(item);
+		id_idx.Touch(id);
+		notify(Change::Updated, item);
+
+		return true;
+	}
+
+	// Hash an entity's id and indexed keys, for the fingerprint
+	static uint64_t entityHash(const T &item) {
+		unsigned int id = item.Id();
+		uint64_t hashes[] = { 0, Indexes::Hash(item)... };
+		uint64_t hash = Checksum(reinterpret_cast<const char*>(&id), sizeof(id));
+		return Checksum(reinterpret_cast<const char*>(hashes), sizeof(hashes), hash);
+	}
+
+	// Hash of a fixed key, which changes if the hash function does
+	static uint64_t hashProbe() {
+		return HashIndex<std::string>::HashOf("Database::Repository");
+	}
+
+	// Tell every listener of a change
+	void notify(Change change, const T &item) const {
+		for (auto &listener : listeners) {
+			listener.second(change, item);
+		}
+	}
+
+	// Start a worker thread building each index
+	template <size_t... I>
+	void buildInBackground(std::index_sequence<I...>) {
+		int expand[] = { 0, (ready[I] = std::async(std::launch::async, &Repository::buildIndex<I>, this).share(), 0)... };
+		(void)expand;
+	}
+
+	template <size_t I>
+	void buildIndex() {
+		TraceSpan span("Repository::BuildIndex");
+
+		auto &index = std::get<I>(indexes);
+		index.Clear();
+		for (auto &item : storage) {
+			index.Insert(item, item.Id());
+		}
+	}
+
+	// Wait for any indexes being built in the background
+	void waitForIndexes() const {
+		for (auto &building : ready) {
+			if (building.valid()) {
+				building.wait();
+			}
+		}
+	}
+
+	// Return the position of an index policy in the tuple of indexes
+	template <class Policy>
+	static size_t position() {
+		bool same[] = { false, std::is_same<Policy, Indexes>::value... };
+		return std::find(std::begin(same) + 1, std::end(same), true) - std::begin(same) - 1;
+	}
+
+	static bool isAnyUnique() {
+		bool unique[] = { false, Indexes::IsUnique... };
+		return std::find(std::begin(unique), std::end(unique), true) != std::end(unique);
+	}
+
+protected:
+	friend class Iterator;
+	Storage storage { NewPooledAllocator<T>() };
+
+private:
+	IdTable<Position>     id_idx;  // Primary index
+	std::tuple<Indexes...> indexes; // Secondary indexes
+
+	// Id allocation
+	unsigned int              next_id = 0;
+	std::vector<unsigned int> free_ids;
+
+	// Change listeners and their handles
+	std::vector<std::pair<unsigned int, Listener>> listeners;
+	unsigned int last_listener = 0;
+
+	// Saved index support
+	uint64_t fingerprint = 0;
+	bool     deferred = false;
+
+	// Indexes being built in the background. Declared last, so that on
+	// destruction the builders are waited for before anything they use
+	// is destroyed.
+	std::array<std::shared_future<void>, sizeof...(Indexes)> ready;
+};
+
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,189 @@
+#ifndef __REPOSITORY_HISTORY_HPP__
+#define __REPOSITORY_HISTORY_HPP__
+
+#include <deque>
+#include <memory>
+#include <functional>
+
+#include "ResearchDocumentRepository.hpp"
+
+namespace Database
+{
+
+/**
+ * RepositoryHistory records changes made to a ResearchDocumentRepository
+ * so that they can be undone and redone.
+ *
+ * It is a journal of changes to the one repository, rather than a set
+ * of snapshots: each step keeps only the state of the single document
+ * it changed, as it was on the other side of the change. Undoing or
+ * redoing a step puts that state back into the repository with one Add,
+ * Remove or Update, so it costs what that change costs (updating every
+ * index for the document's keys), and a step takes no more memory than
+ * a copy of the document.
+ *
+ * Changes must be made through the history for it to stay consistent
+ * with the repository.
+ */
+class RepositoryHistory
+{
+public:
+	RepositoryHistory(ResearchDocumentRepository &repository, size_t limit = 100) : repository(repository), limit(limit) {
+	}
+
+	/**
+	 * Add a document, recording the change
+	 */
+	bool Add(Document document) {
+		unsigned int id = document.Id();
+		if (!repository.Add(std::move(document))) {
+			return false;
+		}
+
+		record(id, nullptr);
+		return true;
+	}
+
+	/**
+	 * Remove the document with the given id, recording the change
+	 */
+	bool Remove(unsigned int id) {
+		auto found = repository.FindOneById(id);
+		if (found == nullptr) {
+			return false;
+		}
+
+		std::unique_ptr<Document> previous(new Document(*found));
+		repository.Remove(*previous);
+
+		record(id, std::move(previous));
+		return true;
+	}
+
+	/**
+	 * Update the document with the given id, recording the change
+	 */
+	bool Update(unsigned int id, std::function<void(Document&)> mutation) {
+		auto found = repository.FindOneById(id);
+		if (found == nullptr) {
+			return false;
+		}
+
+		std::unique_ptr<Document> previous(new Document(*found));
+		if (!repository.Update(id, mutation)) {
+			return false;
+		}
+
+		record(id, std::move(previous));
+		return true;
+	}
+
+	/**
+	 * Undo the most recent change. Returns false if there is nothing to
+	 * undo, or the repository refused the change, which is then left to
+	 * be undone.
+	 */
+	bool Undo() {
+		if (undo.empty() || !swap(undo.back())) {
+			return false;
+		}
+
+		redo.push_back(std::move(undo.back()));
+		undo.pop_back();
+		return true;
+	}
+
+	/**
+	 * Redo the most recently undone change. Returns false if there is
+	 * nothing to redo, or the repository refused the change, which is
+	 * then left to be redone.
+	 */
+	bool Redo() {
+		if (redo.empty() || !swap(redo.back())) {
+			return false;
+		}
+
+		undo.push_back(std::move(redo.back()));
+		redo.pop_back();
+		return true;
+	}
+
+	bool CanUndo() const {
+		return !undo.empty();
+	}
+
+	bool CanRedo() const {
+		return !redo.empty();
+	}
+
+	/**
+	 * Forget all recorded changes
+	 */
+	void Clear() {
+		undo.clear();
+		redo.clear();
+	}
+
+private:
+	// A step holds the state of a document on the other side of the
+	// change: null if the document doesn't exist there.
+	struct Step {
+		unsigned int id;
+		std::unique_ptr<Document> document;
+	};
+
+	// Record a change. A new change invalidates anything that was undone.
+	void record(unsigned int id, std::unique_ptr<Document> previous) {
+		Step step = { id, std::move(previous) };
+		undo.push_back(std::move(step));
+		redo.clear();
+
+		if (undo.size() > limit) {
+			undo.pop_front();
+		}
+	}
+
+	// Exchange the repository's state of a document with the step's.
+	// Returns false, leaving the step as it was, if the repository
+	// refuses the change.
+	bool swap(Step &step) {
+		auto current = repository.FindOneById(step.id);
+
+		if (current == nullptr) {
+			// Document doesn't exist, so restore it. A refused document
+			// isn't moved from.
+			if (!repository.Add(std::move(*step.document))) {
+				return false;
+			}
+			step.document.reset();
+		} else if (step.document == nullptr) {
+			// Document didn't exist, so remove it
+			std::unique_ptr<Document> previous(new Document(*current));
+			if (!repository.Remove(*previous)) {
+				return false;
+			}
+			step.document = std::move(previous);
+		} else {
+			// Document changed, so replace it with the stored version in
+			// place. It's copied rather than swapped in, as a refused
+			// update restores the repository's version over it.
+			std::unique_ptr<Document> previous(new Document(*current));
+			if (!repository.Update(step.id, [&](Document &stored) { stored = *step.document; })) {
+				return false;
+			}
+			step.document = std::move(previous);
+		}
+		return true;
+	}
+
+private:
+	ResearchDocumentRepository &repository;
+	size_t limit;
+
+	std::deque<Step> undo;
+	std::deque<Step> redo;
+};
+
+};
+
+#endif
@@ -1,158 +1,663 @@
-#ifndef __RESEARCH_DOCUMENT_REPOSITORY_HPP__
-#define __RESEARCH_DOCUMENT_REPOSITORY_HPP__
-
-#include <vector>
-#include <map>
-#include <algorithm>
-
-#include "Repository.hpp"
-#include "Document.hpp"
-
-namespace Database
-{
-
-/**
- * The ResearchDocumentRepository implements, using the Repository pattern,
- * methods for the retrival, storage and indexing of the Document class.
- */
-class ResearchDocumentRepository : public Repository<Document> {
-public:
-
-	/**
-	 * The add method takes a document by reference, but creates
-	 * a copy of it for storage. The pointer to the copied document
-	 * is then stored in the indexes (indexing title and id) to prevent
-	 * even more copies.
-	 *
-	 * This method returns true on success, false on failure.
-	 */
-	bool Add(const Document &document) {
-		// Ensure that this document id doesn't already exist
-		if (id_idx.find(document.Id()) != id_idx.end()) {
-			return false;
-		}
-
-		// Store
-		storage.push_back(document);
-
-		// Grab pointer to our stored document
-		Document *doc = &storage.back();
-
-		// Index by Id and Title
-		id_idx[document.Id()] = doc;
-		title_idx.insert( pair_string(document.Title(), doc) );
-
-		// Index authors
-		for (auto &author : document.Authors()) {
-			author_idx.insert( pair_string(author, doc) );
-		}
-
-		return true;
-	}
-
-	/**
-	 * The remove method takes a document by reference and uses
-	 * the documents unique id to remove all indexes the database
-	 * contains in relation to the document, and then the copy of the
-	 * document itself.
-	 *
-	 * This method returns true if the document was found and removed,
-	 * false if otherwise.
-	 */
-	bool Remove(const Document &document) {
-		for (auto it = storage.begin(); it != storage.end(); ++it) {
-			if ((*it).Id() == document.Id()) {
-				// Remove indexes
-				id_idx.erase(id_idx.find(document.Id()));
-				multimapErase<multimap_string>(author_idx, document.Id());
-				multimapErase<multimap_string>(title_idx, document.Id());
-
-				// Remove item
-				storage.erase(it);
-				
-				return true;
-			}
-		}
-		return false;
-	}
-
-	/**
-	 * FindOneById finds a single document by its
-	 * unique id, or else returns null.
-	 */
-	const Document* FindOneById(unsigned int id) {
-		auto found = id_idx.find(id);
-		if (found == id_idx.end()) {
-			return nullptr;
-		}
-
-		return found->second;
-	}
-
-	/**
-	 * FindAll returns a copy of all elements currently
-	 * stored by the database.
-	 */
-	const std::vector<const Document> FindAll() {
-		std::vector<const Document> results;
-		for (auto &d : storage) {
-			results.push_back(d);
-		}
-		return results;
-	}
-
-	/**
-	 * FindManyByAuthor returns all documents by the requested author.
-	 */
-	const std::vector<const Document*> FindManyByAuthor(std::string author) {
-		return multimapFind<multimap_string>(author_idx, author);
-	}
-
-	/**
-	 * FindManyByTitle returns all documents by the requested title.
-	 */
-	const std::vector<const Document*> FindManyByTitle(std::string title) {
-		return multimapFind<multimap_string>(title_idx, title);
-	}
-private:
-	// Multimap Erase helper method. Erases elements by value, rather than key.
-	template <class T>
-	void multimapErase(T& multimap, unsigned int id) {
-		for (auto it = multimap.begin(); it != multimap.end();) {
-			// Increment iterator here to allow us to erase while iterating.
-			auto erase_it = it++;
-
-			if (erase_it->second->Id() == id) {
-				// Erase element
-				multimap.erase(erase_it);
-			}
-		}
-	}
-
-	// Multimap Find helper method. Creates an std::vector of results.
-	template <class T>
-	const std::vector<const Document*> multimapFind(T& multimap, std::string key) {
-		std::vector<const Document*> results;
-
-		// Create a range iterator for our specific key
-		auto range = multimap.equal_range(key);
-		for (auto it = range.first; it != range.second; ++it) {
-			// Add result to vector
-			results.push_back(it->second);
-		}
-		return results;
-	}
-
-private:
-	std::map<const unsigned int, const Document*> id_idx;     // Primary index
-	std::multimap<std::string, const Document*>   author_idx; // Author index
-	std::multimap<std::string, const Document*>   title_idx;  // Title index
-
-	// Create types for common used, long named types
-	typedef std::multimap<std::string, const Document*> multimap_string;
-	typedef std::pair<std::string, const Document*>     pair_string;
-};
-
-};
-
+#ifndef __RESEARCH_DOCUMENT_REPOSITORY_HPP__
+#define __RESEARCH_DOCUMENT_REPOSITORY_HPP__
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iterator>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <cctype>
+#include <ctime>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "Repository.hpp"
+#include "Document.hpp"
+#include "SubstringSearch.hpp"
+#include "SpillStore.hpp"
+#include "MinHash.hpp"
+#include "MetadataColumns.hpp"
+
+namespace Database
+{
+
+/**
+ * ByTitle indexes documents by their title
+ */
+struct ByTitle {
+	typedef std::string Key;
+
+	template <class Func>
+	static void Extract(const Document &document, Func func) {
+		func(document.Title());
+	}
+};
+
+/**
+ * ByAuthor indexes documents by each of their authors
+ */
+struct ByAuthor {
+	typedef std::string Key;
+
+	template <class Func>
+	static void Extract(const Document &document, Func func) {
+		for (auto &author : document.Authors()) {
+			func(author);
+		}
+	}
+};
+
+/**
+ * ByYear indexes documents by the year they were published, in UTC
+ */
+struct ByYear {
+	typedef int Key;
+
+	template <class Func>
+	static void Extract(const Document &document, Func func) {
+		func(Year(document.Published()));
+	}
+
+	/**
+	 * Year returns the year of a time. This avoids std::gmtime, whose
+	 * result is shared, as indexes may be built on several threads.
+	 */
+	static int Year(std::time_t time) {
+		// Whole days since 1970-01-01, converted to a date as in Howard
+		// Hinnant's civil_from_days, counting eras of 400 years from March
+		long long days = static_cast<long long>(time) / 86400;
+		if (static_cast<long long>(time) % 86400 < 0) {
+			--days;
+		}
+		days += 719468;
+
+		long long era = (days >= 0 ? days : days - 146096) / 146097;
+		long long dayOfEra = days - era * 146097;
+		long long yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+		long long dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+		long long month = (5 * dayOfYear + 2) / 153; // From March
+
+		return static_cast<int>(yearOfEra + era * 400 + (month >= 10 ? 1 : 0));
+	}
+};
+
+/**
+ * ByWord indexes documents by each word of their title and authors, in
+ * lower case, so that they can be searched as a query is typed
+ */
+struct ByWord {
+	typedef std::string Key;
+
+	template <class Func>
+	static void Extract(const Document &document, Func func) {
+		std::vector<std::string> words;
+		Split(document.Title(), words);
+		for (auto &author : document.Authors()) {
+			Split(author, words);
+		}
+
+		std::sort(words.begin(), words.end());
+		words.erase(std::unique(words.begin(), words.end()), words.end());
+		for (auto &word : words) {
+			func(word);
+		}
+	}
+
+	/**
+	 * Split appends the words of some text: runs of letters and digits
+	 * (and any non-ASCII characters), in lower case
+	 */
+	static void Split(const std::string &text, std::vector<std::string> &words) {
+		std::string word;
+		for (char c : text) {
+			unsigned char u = static_cast<unsigned char>(c);
+			if (u >= 0x80 || std::isalnum(u)) {
+				word += static_cast<char>(std::tolower(u));
+			} else if (!word.empty()) {
+				words.push_back(std::move(word));
+				word.clear();
+			}
+		}
+		if (!word.empty()) {
+			words.push_back(std::move(word));
+		}
+	}
+};
+
+/**
+ * ByBodyBand indexes documents by the band keys of their body's MinHash
+ * signature, so that documents with similar bodies are likely to share
+ * a key (see MinHash)
+ */
+struct ByBodyBand {
+	typedef uint64_t Key;
+
+	template <class Func>
+	static void Extract(const Document &document, Func func) {
+		MinHash::Signature signature = MinHash::Sign(document.Body());
+		if (!MinHash::IsEmpty(signature)) {
+			MinHash::BandKeys(signature, func);
+		}
+	}
+
+	/**
+	 * Hash fingerprints the body itself, as signing it for every change
+	 * is far too slow, and lets a change that leaves the body alone skip
+	 * signing it again (see Index::Hash and Index::Reindex)
+	 */
+	static uint64_t Hash(const Document &document) {
+		return Checksum(document.Body().data(), document.Body().size());
+	}
+};
+
+/**
+ * The ResearchDocumentRepository implements, using the Repository pattern,
+ * methods for the retrival, storage and indexing of the Document class.
+ *
+ * Documents are indexed by id, title, author and year, by the words of
+ * their title and authors, and by the MinHash bands of their body for
+ * finding near-duplicates. Their ids, publication times, titles and
+ * first authors are also kept in columns, for scans and sorts over
+ * those fields (see Columns). Storage and index maintenance are
+ * provided by Repository.
+ *
+ * The memory held by document bodies can be limited by a budget, beyond
+ * which bodies are evicted to a spill file (see SetMemoryBudget).
+ */
+class ResearchDocumentRepository : public Repository<Document, Index<ByTitle>, Index<ByAuthor>, Index<ByWord, Ordered>, Index<ByYear, Ordered>, Index<ByBodyBand>, MetadataColumns> {
+public:
+	/**
+	 * A ScanMatch is reported by ScanBodies for the first occurrence
+	 * of a pattern within a document's body.
+	 */
+	struct ScanMatch {
+		const Document *document;
+		size_t          pattern; // Index into the requested patterns
+		size_t          offset;  // Offset into the document's body
+	};
+
+	/**
+	 * A NearDuplicate is a document whose body is alike another's, with
+	 * their estimated similarity (see MinHash::Similarity)
+	 */
+	struct NearDuplicate {
+		const Document *document;
+		double          similarity;
+	};
+
+	/**
+	 * A DuplicatePair is a pair of documents with alike bodies, reported
+	 * by FindAllNearDuplicates. The first has the lower id.
+	 */
+	struct DuplicatePair {
+		const Document *first;
+		const Document *second;
+		double          similarity;
+	};
+
+	/**
+	 * FindManyByAuthor returns a view of all documents by the requested author.
+	 */
+	IndexView FindManyByAuthor(const std::string &author) const {
+		return FindManyBy<ByAuthor>(author);
+	}
+
+	/**
+	 * FindManyByTitle returns a view of all documents by the requested title.
+	 */
+	IndexView FindManyByTitle(const std::string &title) const {
+		return FindManyBy<ByTitle>(title);
+	}
+
+	/**
+	 * CountByAuthor returns the number of documents by each author, in
+	 * no particular order, optionally only counting those within a set
+	 */
+	std::vector<std::pair<std::string, size_t>> CountByAuthor() const {
+		return Facet<ByAuthor>();
+	}
+
+	std::vector<std::pair<std::string, size_t>> CountByAuthor(const IdSet &within) const {
+		return Facet<ByAuthor>(within);
+	}
+
+	/**
+	 * CountByYear returns the number of documents published in each
+	 * year, in order of year, optionally only counting those within a set
+	 */
+	std::vector<std::pair<int, size_t>> CountByYear() const {
+		return Facet<ByYear>();
+	}
+
+	std::vector<std::pair<int, size_t>> CountByYear(const IdSet &within) const {
+		return Facet<ByYear>(within);
+	}
+
+	/**
+	 * MostProlificAuthors returns the k authors with the most documents,
+	 * most first, optionally only counting those within a set
+	 */
+	std::vector<std::pair<std::string, size_t>> MostProlificAuthors(size_t k) const {
+		return TopKeys<ByAuthor>(k);
+	}
+
+	std::vector<std::pair<std::string, size_t>> MostProlificAuthors(size_t k, const IdSet &within) const {
+		return TopKeys<ByAuthor>(k, within);
+	}
+
+	/**
+	 * MostRecent returns the k most recently published documents, newest
+	 * first, optionally only from those within a set.
+	 *
+	 * Years are walked from the latest, using the year index, until at
+	 * least k documents are found. Only those are sorted, rather than
+	 * every document.
+	 */
+	std::vector<const Document*> MostRecent(size_t k) const {
+		return mostRecent(k, nullptr);
+	}
+
+	std::vector<const Document*> MostRecent(size_t k, const IdSet &within) const {
+		return mostRecent(k, &within);
+	}
+
+	/**
+	 * FindPublishedBetween returns the documents published from one time
+	 * up to (but not including) another, in no particular order, by
+	 * scanning the column of publication times
+	 */
+	std::vector<const Document*> FindPublishedBetween(std::time_t from, std::time_t to) const {
+		TraceSpan span("ResearchDocumentRepository::FindPublishedBetween");
+
+		std::vector<const Document*> found;
+		for (auto id : Columns().PublishedBetween(from, to)) {
+			found.push_back(FindOneById(id));
+		}
+		return found;
+	}
+
+	/**
+	 * Return the documents' metadata columns, first waiting for them to
+	 * be built if indexes are being built in the background
+	 */
+	const MetadataColumns &Columns() const {
+		return GetIndex<MetadataColumns>();
+	}
+
+	/**
+	 * FindMatching returns the documents with a word in their title or
+	 * authors starting with each word of the query, in order of id. A
+	 * query without any words matches nothing.
+	 *
+	 * Each word of the query is a range of the word index, so only
+	 * matching documents are visited. The longest words are looked up
+	 * first, as they usually match the fewest documents.
+	 *
+	 * The search stops, returning nothing, as soon as cancelled returns true.
+	 */
+	std::vector<const Document*> FindMatching(const std::string &query, const std::function<bool()> &cancelled = nullptr) const {
+		TraceSpan span("ResearchDocumentRepository::FindMatching");
+
+		std::vector<std::string> prefixes;
+		ByWord::Split(query, prefixes);
+		std::sort(prefixes.begin(), prefixes.end(), [](const std::string &a, const std::string &b) {
+			return a.size() > b.size();
+		});
+
+		auto &words = GetIndex<ByWord>().Keys().Keys();
+		std::vector<unsigned int> ids, matching, both;
+		for (size_t p = 0; p < prefixes.size(); ++p) {
+			const std::string &prefix = prefixes[p];
+
+			matching.clear();
+			for (auto it = words.lower_bound(prefix); it != words.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it) {
+				if (cancelled && cancelled()) {
+					return std::vector<const Document*>();
+				}
+				matching.insert(matching.end(), it->second.begin(), it->second.end());
+			}
+			std::sort(matching.begin(), matching.end());
+			matching.erase(std::unique(matching.begin(), matching.end()), matching.end());
+
+			if (p == 0) {
+				ids.swap(matching);
+			} else {
+				both.clear();
+				std::set_intersection(ids.begin(), ids.end(), matching.begin(), matching.end(), std::back_inserter(both));
+				ids.swap(both);
+			}
+
+			if (ids.empty()) {
+				break;
+			}
+		}
+
+		if (cancelled && cancelled()) {
+			return std::vector<const Document*>();
+		}
+
+		std::vector<const Document*> found;
+		found.reserve(ids.size());
+		for (auto id : ids) {
+			found.push_back(FindOneById(id));
+		}
+		return found;
+	}
+
+	/**
+	 * FindNearDuplicates returns the other documents whose bodies are at
+	 * least threshold alike the given document's, most alike first. The
+	 * document need not be stored, so this can be used to check a
+	 * document before it is added.
+	 *
+	 * Only documents sharing a band key with the document are compared,
+	 * so the cost depends on the number of near-duplicates rather than
+	 * the size of the repository. Pairs much less alike than 0.8 may be
+	 * missed (see MinHash).
+	 */
+	std::vector<NearDuplicate> FindNearDuplicates(const Document &document, double threshold = 0.8) const {
+		TraceSpan span("ResearchDocumentRepository::FindNearDuplicates");
+
+		MinHash::Signature signature = MinHash::Sign(document.Body());
+		std::vector<NearDuplicate> found;
+		if (MinHash::IsEmpty(signature)) {
+			return found;
+		}
+
+		std::unordered_set<unsigned int> candidates;
+		auto &bands = GetIndex<ByBodyBand>();
+		MinHash::BandKeys(signature, [&](uint64_t key) {
+			if (auto ids = bands.Find(key)) {
+				candidates.insert(ids->begin(), ids->end());
+			}
+		});
+		candidates.erase(document.Id());
+
+		for (auto id : candidates) {
+			const Document *candidate = FindOneById(id);
+			double similarity = MinHash::Similarity(signature, MinHash::Sign(candidate->Body()));
+			if (similarity >= threshold) {
+				NearDuplicate duplicate = { candidate, similarity };
+				found.push_back(duplicate);
+			}
+		}
+
+		std::sort(found.begin(), found.end(), [](const NearDuplicate &a, const NearDuplicate &b) {
+			return a.similarity > b.similarity || (a.similarity == b.similarity && a.document->Id() < b.document->Id());
+		});
+		return found;
+	}
+
+	/**
+	 * FindNearDuplicates of a stored document, by its id
+	 */
+	std::vector<NearDuplicate> FindNearDuplicates(unsigned int id, double threshold = 0.8) const {
+		const Document *document = FindOneById(id);
+		return document == nullptr ? std::vector<NearDuplicate>() : FindNearDuplicates(*document, threshold);
+	}
+
+	/**
+	 * FindAllNearDuplicates reports every pair of documents whose bodies
+	 * are at least threshold alike, most alike first.
+	 *
+	 * Pairs are drawn from documents sharing a band key, and each
+	 * document's signature is computed once, so this takes near-linear
+	 * time unless a great many documents are alike.
+	 */
+	std::vector<DuplicatePair> FindAllNearDuplicates(double threshold = 0.8) const {
+		TraceSpan span("ResearchDocumentRepository::FindAllNearDuplicates");
+
+		// Candidate pairs, the lower id in the high half
+		std::unordered_set<uint64_t> pairs;
+		GetIndex<ByBodyBand>().Keys().ForEach([&](uint64_t, const Index<ByBodyBand>::Postings &ids) {
+			for (size_t i = 0; i < ids.size(); ++i) {
+				for (size_t j = i + 1; j < ids.size(); ++j) {
+					unsigned int a = std::min(ids[i], ids[j]), b = std::max(ids[i], ids[j]);
+					if (a != b) {
+						pairs.insert(static_cast<uint64_t>(a) << 32 | b);
+					}
+				}
+			}
+		});
+
+		std::unordered_map<unsigned int, MinHash::Signature> signatures;
+		auto signatureOf = [&](const Document *document) -> const MinHash::Signature & {
+			auto found = signatures.find(document->Id());
+			if (found == signatures.end()) {
+				found = signatures.emplace(document->Id(), MinHash::Sign(document->Body())).first;
+			}
+			return found->second;
+		};
+
+		std::vector<DuplicatePair> found;
+		for (auto pair : pairs) {
+			const Document *first = FindOneById(static_cast<unsigned int>(pair >> 32));
+			const Document *second = FindOneById(static_cast<unsigned int>(pair));
+			double similarity = MinHash::Similarity(signatureOf(first), signatureOf(second));
+			if (similarity >= threshold) {
+				DuplicatePair duplicate = { first, second, similarity };
+				found.push_back(duplicate);
+			}
+		}
+
+		std::sort(found.begin(), found.end(), [](const DuplicatePair &a, const DuplicatePair &b) {
+			if (a.similarity != b.similarity) {
+				return a.similarity > b.similarity;
+			}
+			return a.first->Id() < b.first->Id() || (a.first->Id() == b.first->Id() && a.second->Id() < b.second->Id());
+		});
+		return found;
+	}
+
+	/**
+	 * ScanBodies performs a brute-force search of every document's body
+	 * for each of the patterns, for queries no index can answer.
+	 *
+	 * Documents are divided between one thread per core. Matches are
+	 * passed to onMatch as soon as they are found, one call at a time,
+	 * but in no particular order. onMatch may return false to stop the
+	 * scan early.
+	 */
+	void ScanBodies(const std::vector<std::string> &patterns, std::function<bool(const ScanMatch&)> onMatch) const {
+		TraceSpan span("ResearchDocumentRepository::ScanBodies");
+
+		std::vector<SubstringSearch> searches(patterns.begin(), patterns.end());
+
+		// Grab pointers to our stored documents so they can be shared out
+		std::vector<const Document*> documents;
+		documents.reserve(storage.size());
+		for (auto &d : storage) {
+			documents.push_back(&d);
+		}
+
+		std::atomic<size_t> next(0);
+		std::atomic<bool> stopped(false);
+		std::mutex reportMutex;
+
+		// Each worker claims small batches of documents until none remain,
+		// keeping the threads busy even when body sizes vary greatly.
+		auto worker = [&] {
+			const size_t batch = 16;
+			for (size_t begin = next.fetch_add(batch); begin < documents.size() && !stopped; begin = next.fetch_add(batch)) {
+				size_t end = std::min(begin + batch, documents.size());
+				for (size_t i = begin; i < end && !stopped; ++i) {
+					auto &body = documents[i]->Body();
+					for (size_t p = 0; p < searches.size(); ++p) {
+						size_t offset = searches[p].Find(body);
+						if (offset == SubstringSearch::npos) {
+							continue;
+						}
+
+						ScanMatch match = { documents[i], p, offset };
+						std::lock_guard<std::mutex> lock(reportMutex);
+						if (!stopped && !onMatch(match)) {
+							stopped = true;
+						}
+					}
+				}
+			}
+		};
+
+		// Small collections aren't worth the cost of starting threads
+		size_t threadCount = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), documents.size() / 64 + 1);
+
+		std::vector<std::thread> threads;
+		for (size_t t = 1; t < threadCount; ++t) {
+			threads.emplace_back(worker);
+		}
+		worker();
+		for (auto &t : threads) {
+			t.join();
+		}
+	}
+
+	/**
+	 * ScanBodies for a single pattern
+	 */
+	void ScanBodies(const std::string &pattern, std::function<bool(const ScanMatch&)> onMatch) const {
+		ScanBodies(std::vector<std::string>(1, pattern), onMatch);
+	}
+
+	/**
+	 * SetMemoryBudget limits the bytes held in memory by document bodies.
+	 * Whenever a change takes them over budget, the bodies that haven't
+	 * been read recently are evicted to a spill file at spillPath, and
+	 * are reloaded when next read. A budget of zero removes the limit.
+	 *
+	 * Returns false, leaving no budget set, if the spill file couldn't
+	 * be opened.
+	 */
+	bool SetMemoryBudget(size_t bytes, const std::string &spillPath) {
+		// Reload everything from an old spill file before it is deleted
+		for (auto &document : storage) {
+			document.Body();
+		}
+		spill.reset();
+
+		budget = 0;
+		if (bytes == 0) {
+			return true;
+		}
+
+		spill.reset(new SpillStore(spillPath));
+		if (!spill->IsOpen()) {
+			spill.reset();
+			return false;
+		}
+		budget = bytes;
+		if (!budgeted) {
+			Listen([this](Change change, const Document &document) {
+				if (change != Change::Removed && spill) {
+					estimate += document.ResidentBytes();
+					if (estimate > budget) {
+						EnforceMemoryBudget();
+					}
+				}
+			});
+			budgeted = true;
+		}
+		EnforceMemoryBudget();
+		return true;
+	}
+
+	/**
+	 * EnforceMemoryBudget evicts bodies until those in memory are within
+	 * the budget. This is done automatically as documents are added and
+	 * updated, but bodies reloaded since are only evicted by a later call.
+	 *
+	 * Eviction gives each body read since the previous call a second
+	 * chance, and goes a little below the budget, so that it isn't
+	 * needed again on the very next change. Should the spill file fail
+	 * to write a body, eviction stops with the rest left in memory.
+	 */
+	void EnforceMemoryBudget() {
+		TraceSpan span("ResearchDocumentRepository::EnforceMemoryBudget");
+
+		if (!spill) {
+			return;
+		}
+
+		size_t resident = BodyMemory();
+		size_t target = resident > budget ? budget - budget / 8 : resident;
+		bool failed = false;
+		for (int pass = 0; pass < 2 && resident > target && !failed; ++pass) {
+			for (auto &document : storage) {
+				if (resident <= target) {
+					break;
+				}
+				if (!document.Resident()) {
+					continue;
+				}
+				if (pass == 0 && document.Recent()) {
+					document.ClearRecent();
+					continue;
+				}
+
+				size_t bytes = document.ResidentBytes();
+				if (!document.Evict(*spill)) {
+					failed = true;
+					break;
+				}
+				resident -= bytes;
+			}
+		}
+		estimate = resident;
+	}
+
+	/**
+	 * Return the bytes held in memory by document bodies
+	 */
+	size_t BodyMemory() const {
+		size_t bytes = 0;
+		for (auto &document : storage) {
+			bytes += document.ResidentBytes();
+		}
+		return bytes;
+	}
+
+	/**
+	 * Return the bytes written to the spill file
+	 */
+	uint64_t SpilledMemory() const {
+		return spill ? spill->Size() : 0;
+	}
+
+private:
+	std::vector<const Document*> mostRecent(size_t k, const IdSet *within) const {
+		TraceSpan span("ResearchDocumentRepository::MostRecent");
+
+		std::vector<const Document*> recent;
+
+		// Every document of a year is newer than those of earlier years,
+		// so once k are found, earlier years can be skipped
+		auto &years = GetIndex<ByYear>().Keys().Keys();
+		for (auto year = years.rbegin(); year != years.rend() && recent.size() < k; ++year) {
+			for (auto id : year->second) {
+				if (within == nullptr || within->Contains(id)) {
+					recent.push_back(FindOneById(id));
+				}
+			}
+		}
+
+		size_t shown = std::min(k, recent.size());
+		std::partial_sort(recent.begin(), recent.begin() + shown, recent.end(), [](const Document *a, const Document *b) {
+			return a->Published() > b->Published() || (a->Published() == b->Published() && a->Id() < b->Id());
+		});
+		recent.resize(shown);
+		return recent;
+	}
+
+private:
+	std::unique_ptr<SpillStore> spill;
+	size_t budget = 0;
+	size_t estimate = 0; // Of BodyMemory, counting changes since the last eviction
+	bool   budgeted = false;
+};
+
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,142 @@
+#ifndef __RESULT_VIEW_HPP__
+#define __RESULT_VIEW_HPP__
+
+#include <iterator>
+#include <algorithm>
+#include <utility>
+#include <cstddef>
+#include <type_traits>
+
+namespace Database
+{
+
+/**
+ * A ResultView is a lightweight, lazily evaluated range over results
+ * held elsewhere (typically a repository's storage or one of its indexes).
+ *
+ * Nothing is copied when a view is created or iterated; the projection
+ * turns each underlying iterator into a reference to an entity as it is
+ * visited. A view is only valid until the repository it came from is
+ * next modified.
+ */
+template <class BaseIterator, class Projection>
+class ResultView
+{
+public:
+	typedef typename std::remove_reference<decltype(std::declval<const Projection&>()(std::declval<const BaseIterator&>()))>::type value_type;
+
+	/**
+	 * Iterator class used for iteration over the results
+	 */
+	class Iterator
+	{
+		BaseIterator it;
+		Projection projection;
+
+	public:
+		typedef std::forward_iterator_tag iterator_category;
+		typedef typename ResultView::value_type value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef value_type *pointer;
+		typedef value_type &reference;
+
+		Iterator(BaseIterator it, Projection projection) : it(it), projection(projection) {
+		}
+
+		bool operator==(const Iterator &other) const {
+			return it == other.it;
+		}
+
+		bool operator!=(const Iterator &other) const {
+			return it != other.it;
+		}
+
+		Iterator &operator++() {
+			++it;
+			return *this;
+		}
+
+		Iterator operator++(int) {
+			Iterator previous = *this;
+			++it;
+			return previous;
+		}
+
+		reference operator*() const {
+			return projection(it);
+		}
+
+		pointer operator->() const {
+			return &projection(it);
+		}
+	};
+
+	ResultView(BaseIterator first, BaseIterator last, Projection projection = Projection()) :
+		first(first), last(last), projection(projection) {
+	}
+
+	Iterator begin() const {
+		return Iterator(first, projection);
+	}
+
+	Iterator end() const {
+		return Iterator(last, projection);
+	}
+
+	/**
+	 * Return the number of results. This walks the range unless the
+	 * underlying iterators are random access.
+	 */
+	size_t size() const {
+		return static_cast<size_t>(std::distance(first, last));
+	}
+
+	/**
+	 * Return whether there are no results
+	 */
+	bool empty() const {
+		return first == last;
+	}
+
+	/**
+	 * Return the first result. The view must not be empty.
+	 */
+	const value_type &front() const {
+		return projection(first);
+	}
+
+	/**
+	 * Page returns a view of at most limit results, starting offset
+	 * results into this view.
+	 */
+	ResultView Page(size_t offset, size_t limit) const {
+		BaseIterator pageFirst = skip(first, offset);
+		return ResultView(pageFirst, skip(pageFirst, limit), projection);
+	}
+
+private:
+	// Advance an iterator by up to count positions, stopping at the end
+	BaseIterator skip(BaseIterator it, size_t count) const {
+		skip(it, count, typename std::iterator_traits<BaseIterator>::iterator_category());
+		return it;
+	}
+
+	void skip(BaseIterator &it, size_t count, std::random_access_iterator_tag) const {
+		it += static_cast<std::ptrdiff_t>(std::min<size_t>(count, last - it));
+	}
+
+	void skip(BaseIterator &it, size_t count, std::input_iterator_tag) const {
+		for (; count > 0 && it != last; --count) {
+			++it;
+		}
+	}
+
+private:
+	BaseIterator first;
+	BaseIterator last;
+	Projection projection;
+};
+
+};
+
+#endif
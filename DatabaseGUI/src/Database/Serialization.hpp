@@ -0,0 +1,203 @@
+#ifndef __SERIALIZATION_HPP__
+#define __SERIALIZATION_HPP__
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <type_traits>
+
+namespace Database
+{
+
+/**
+ * Checksum returns the 64-bit FNV-1a hash of a block of bytes
+ */
+inline uint64_t Checksum(const char *data, size_t length, uint64_t hash = 14695981039346656037ull) {
+	for (size_t i = 0; i < length; ++i) {
+		hash ^= static_cast<unsigned char>(data[i]);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+/**
+ * The BinaryWriter appends fixed-width values and arrays to a buffer.
+ *
+ * Values are written in the machine's byte order, and arrays can be
+ * aligned, so that a buffer can be used in place (for example, when
+ * memory mapped) by a reader on the same platform.
+ */
+class BinaryWriter
+{
+public:
+	template <class T>
+	void Write(const T &value) {
+		static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be written");
+		buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+	}
+
+	template <class T>
+	void WriteArray(const T *values, size_t count) {
+		static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be written");
+		Align(8);
+		buffer.append(reinterpret_cast<const char*>(values), sizeof(T) * count);
+	}
+
+	void WriteBytes(const char *data, size_t length) {
+		buffer.append(data, length);
+	}
+
+	/**
+	 * Write a string as its length followed by its characters
+	 */
+	void WriteString(const std::string &value) {
+		Write<uint32_t>(static_cast<uint32_t>(value.size()));
+		WriteBytes(value.data(), value.size());
+	}
+
+	/**
+	 * Pad the buffer with zeroes to a multiple of alignment bytes
+	 */
+	void Align(size_t alignment) {
+		buffer.append((alignment - buffer.size() % alignment) % alignment, '\0');
+	}
+
+	const std::string &Buffer() const {
+		return buffer;
+	}
+
+private:
+	std::string buffer;
+};
+
+/**
+ * The BinaryReader reads back what a BinaryWriter wrote. Every read is
+ * bounds checked; once a read fails, all further reads fail too.
+ */
+class BinaryReader
+{
+public:
+	BinaryReader(const char *data, size_t length) : data(data), length(length), offset(0), failed(false) {
+	}
+
+	template <class T>
+	bool Read(T &value) {
+		static_assert(std::is_trivially_copyable<T>::value, "Only plain values can be read");
+		if (!available(sizeof(T))) {
+			return false;
+		}
+		std::memcpy(&value, data + offset, sizeof(T));
+		offset += sizeof(T);
+		return true;
+	}
+
+	/**
+	 * ReadArray returns a pointer to count values within the buffer,
+	 * or null if there aren't enough bytes left.
+	 */
+	template <class T>
+	const T *ReadArray(size_t count) {
+		Align(8);
+
+		// Check the count first, as its size in bytes may overflow
+		if (count > length / sizeof(T) || !available(sizeof(T) * count)) {
+			return nullptr;
+		}
+		const T *values = reinterpret_cast<const T*>(data + offset);
+		offset += sizeof(T) * count;
+		return values;
+	}
+
+	const char *ReadBytes(size_t count) {
+		if (!available(count)) {
+			return nullptr;
+		}
+		const char *bytes = data + offset;
+		offset += count;
+		return bytes;
+	}
+
+	bool ReadString(std::string &value) {
+		uint32_t size = 0;
+		if (!Read(size)) {
+			return false;
+		}
+		const char *bytes = ReadBytes(size);
+		if (bytes == nullptr) {
+			return false;
+		}
+		value.assign(bytes, size);
+		return true;
+	}
+
+	void Align(size_t alignment) {
+		size_t padding = (alignment - offset % alignment) % alignment;
+		if (available(padding)) {
+			offset += padding;
+		}
+	}
+
+	bool Failed() const {
+		return failed;
+	}
+
+	/**
+	 * Return the number of bytes left to read
+	 */
+	size_t Remaining() const {
+		return length - offset;
+	}
+
+private:
+	bool available(size_t count) {
+		if (failed || length - offset < count) {
+			failed = true;
+			return false;
+		}
+		return true;
+	}
+
+private:
+	const char *data;
+	size_t length;
+	size_t offset;
+	bool failed;
+};
+
+/**
+ * KeyCodec converts index keys to and from bytes. Strings are stored as
+ * their characters and plain values as their bytes.
+ */
+template <class Key, class Enable = void>
+struct KeyCodec {
+	static_assert(std::is_trivially_copyable<Key>::value, "Keys must be strings or plain values");
+
+	static void Encode(const Key &key, std::string &out) {
+		out.append(reinterpret_cast<const char*>(&key), sizeof(Key));
+	}
+
+	static bool Decode(const char *data, size_t length, Key &key) {
+		if (length != sizeof(Key)) {
+			return false;
+		}
+		std::memcpy(&key, data, sizeof(Key));
+		return true;
+	}
+};
+
+template <>
+struct KeyCodec<std::string> {
+	static void Encode(const std::string &key, std::string &out) {
+		out.append(key);
+	}
+
+	static bool Decode(const char *data, size_t length, std::string &key) {
+		key.assign(data, length);
+		return true;
+	}
+};
+
+};
+
+#endif
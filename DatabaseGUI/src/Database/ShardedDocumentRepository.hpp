@@ -0,0 +1,262 @@
+#ifndef __SHARDED_DOCUMENT_REPOSITORY_HPP__
+#define __SHARDED_DOCUMENT_REPOSITORY_HPP__
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <future>
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+#include "ResearchDocumentRepository.hpp"
+#include "SubstringSearch.hpp"
+#include "ThreadPool.hpp"
+
+namespace Database
+{
+
+/**
+ * The ShardedDocumentRepository partitions documents across a number of
+ * ResearchDocumentRepository shards (by default one per core) by blocks
+ * of their ids (see BlockSize), so that each shard's storage and indexes
+ * stay small.
+ *
+ * A change, or a lookup by id, goes straight to the one shard holding
+ * the document. Queries by author and title, and scans of every
+ * document, run on all shards at once on a work-stealing ThreadPool,
+ * and their results are merged in order of id.
+ *
+ * Queries may run alongside one another, but not alongside changes.
+ */
+class ShardedDocumentRepository
+{
+public:
+	// Query results, in order of id
+	typedef std::vector<const Document*> Results;
+
+	explicit ShardedDocumentRepository(size_t shardCount = std::thread::hardware_concurrency()) : pool(shardCount == 0 ? 1 : shardCount) {
+		for (size_t i = 0; i < pool.Size(); ++i) {
+			shards.emplace_back(new ResearchDocumentRepository());
+		}
+	}
+
+	/**
+	 * Add a document to its shard.
+	 *
+	 * This method returns true on success, false if the id is already in use.
+	 */
+	bool Add(Document document) {
+		unsigned int id = document.Id();
+		if (!shardOf(id).Add(std::move(document))) {
+			return false;
+		}
+
+		next_id = std::max(next_id, id + 1);
+		return true;
+	}
+
+	/**
+	 * Remove a document from its shard. Returns false if it wasn't found.
+	 */
+	bool Remove(const Document &document) {
+		return shardOf(document.Id()).Remove(document);
+	}
+
+	/**
+	 * Update a document in place, see Repository::Update
+	 */
+	bool Update(unsigned int id, std::function<void(Document&)> mutation) {
+		return shardOf(id).Update(id, std::move(mutation));
+	}
+
+	/**
+	 * NextId returns an id higher than any yet used, for a new document
+	 */
+	unsigned int NextId() const {
+		return next_id;
+	}
+
+	/**
+	 * FindOneById finds a document in its shard, or else returns null
+	 */
+	const Document *FindOneById(unsigned int id) const {
+		return shardOf(id).FindOneById(id);
+	}
+
+	/**
+	 * FindAll returns every document
+	 */
+	Results FindAll() const {
+		return fanOut([](const ResearchDocumentRepository &shard) {
+			return collect(shard.FindAll());
+		});
+	}
+
+	/**
+	 * FindManyByAuthor returns all documents by the requested author
+	 */
+	Results FindManyByAuthor(const std::string &author) const {
+		return fanOut([&](const ResearchDocumentRepository &shard) {
+			return collect(shard.FindManyByAuthor(author));
+		});
+	}
+
+	/**
+	 * FindManyByTitle returns all documents with the requested title
+	 */
+	Results FindManyByTitle(const std::string &title) const {
+		return fanOut([&](const ResearchDocumentRepository &shard) {
+			return collect(shard.FindManyByTitle(title));
+		});
+	}
+
+	/**
+	 * FindMatching returns all documents with words starting with each
+	 * word of the query, see ResearchDocumentRepository::FindMatching
+	 */
+	Results FindMatching(const std::string &query) const {
+		return fanOut([&](const ResearchDocumentRepository &shard) {
+			return shard.FindMatching(query);
+		});
+	}
+
+	/**
+	 * FindBodiesContaining scans every document's body, returning
+	 * those containing the pattern
+	 */
+	Results FindBodiesContaining(const std::string &pattern) const {
+		SubstringSearch search(pattern);
+		return fanOut([&](const ResearchDocumentRepository &shard) {
+			Results found;
+			for (auto &document : shard.FindAll()) {
+				if (search.Find(document.Body()) != SubstringSearch::npos) {
+					found.push_back(&document);
+				}
+			}
+			return found;
+		});
+	}
+
+	/**
+	 * Return the number of documents across all shards
+	 */
+	size_t Size() const {
+		size_t size = 0;
+		for (auto &shard : shards) {
+			size += shard->Size();
+		}
+		return size;
+	}
+
+	/**
+	 * Return the number of shards
+	 */
+	size_t ShardCount() const {
+		return shards.size();
+	}
+
+	/**
+	 * Return a shard, for inspecting how documents are spread
+	 */
+	const ResearchDocumentRepository &Shard(size_t shard) const {
+		return *shards[shard];
+	}
+
+private:
+	// Ids are dealt out to the shards in blocks, a page of a shard's id
+	// table (see IdTable), so that each shard holds dense runs of ids.
+	// Spreading single ids would leave every shard's id table and
+	// columns covering the whole range of ids.
+	enum { BlockSize = 4096 };
+
+	size_t shardIndex(unsigned int id) const {
+		return static_cast<size_t>(id / BlockSize % shards.size());
+	}
+
+	ResearchDocumentRepository &shardOf(unsigned int id) {
+		return *shards[shardIndex(id)];
+	}
+
+	const ResearchDocumentRepository &shardOf(unsigned int id) const {
+		return *shards[shardIndex(id)];
+	}
+
+	template <class View>
+	static Results collect(const View &view) {
+		Results results;
+		results.reserve(view.size());
+		for (auto &document : view) {
+			results.push_back(&document);
+		}
+		return results;
+	}
+
+	static bool byId(const Document *a, const Document *b) {
+		return a->Id() < b->Id();
+	}
+
+	// Run a query on every shard in the pool, each sorting its own
+	// results by id, then merge them
+	template <class Query>
+	Results fanOut(Query query) const {
+		std::vector<std::future<Results>> pending;
+		pending.reserve(shards.size());
+		for (auto &shard : shards) {
+			const ResearchDocumentRepository *target = shard.get();
+			pending.push_back(pool.Submit([target, &query] {
+				Results results = query(*target);
+				std::sort(results.begin(), results.end(), byId);
+				return results;
+			}));
+		}
+
+		std::vector<Results> parts;
+		parts.reserve(pending.size());
+		for (auto &part : pending) {
+			parts.push_back(part.get());
+		}
+		return merge(parts);
+	}
+
+	// Merge results sorted by id, taking the lowest head each time
+	static Results merge(const std::vector<Results> &parts) {
+		typedef std::pair<size_t, size_t> Head; // Part, and position within it
+
+		auto later = [&](const Head &a, const Head &b) {
+			return byId(parts[b.first][b.second], parts[a.first][a.second]);
+		};
+		std::priority_queue<Head, std::vector<Head>, decltype(later)> heads(later);
+
+		size_t total = 0;
+		for (size_t i = 0; i < parts.size(); ++i) {
+			total += parts[i].size();
+			if (!parts[i].empty()) {
+				heads.push(Head(i, 0));
+			}
+		}
+
+		Results merged;
+		merged.reserve(total);
+		while (!heads.empty()) {
+			Head head = heads.top();
+			heads.pop();
+
+			merged.push_back(parts[head.first][head.second]);
+			if (++head.second < parts[head.first].size()) {
+				heads.push(head);
+			}
+		}
+		return merged;
+	}
+
+private:
+	std::vector<std::unique_ptr<ResearchDocumentRepository>> shards;
+	mutable ThreadPool pool;
+
+	unsigned int next_id = 0;
+};
+
+};
+
+#endif
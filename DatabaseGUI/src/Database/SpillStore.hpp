@@ -0,0 +1,99 @@
+#ifndef __SPILL_STORE_HPP__
+#define __SPILL_STORE_HPP__
+
+#include <string>
+#include <fstream>
+#include <cstdio>
+#include <cstdint>
+
+#include "Document.hpp"
+
+namespace Database
+{
+
+/**
+ * The SpillStore keeps evicted document bodies in a temporary file,
+ * which is deleted along with the store.
+ *
+ * Bodies are appended to the file, each after its length, and the file
+ * is never compacted: a body is written again each time it's evicted.
+ */
+class SpillStore : public BodyStore
+{
+public:
+	explicit SpillStore(std::string path) : path(std::move(path)), size(0) {
+		file.open(this->path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+	}
+
+	~SpillStore() {
+		file.close();
+		std::remove(path.c_str());
+	}
+
+	SpillStore(const SpillStore &) = delete;
+	SpillStore &operator=(const SpillStore &) = delete;
+
+	/**
+	 * Append a body to the file. A failed write is overwritten by the
+	 * next one, as the size only counts those that succeeded.
+	 */
+	bool Write(const std::string &body, uint64_t &offset) override {
+		std::lock_guard<std::mutex> lock(Mutex());
+
+		uint64_t length = body.size();
+		file.seekp(static_cast<std::streamoff>(size));
+		file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+		file.write(body.data(), body.size());
+		if (!file) {
+			file.clear();
+			return false;
+		}
+
+		offset = size;
+		size += sizeof(length) + body.size();
+		return true;
+	}
+
+	/**
+	 * Read a body back. The caller holds the store's mutex (see Document).
+	 */
+	bool Read(uint64_t offset, std::string &body) const override {
+		uint64_t length = 0;
+		file.seekg(static_cast<std::streamoff>(offset));
+		if (!file.read(reinterpret_cast<char*>(&length), sizeof(length)) || length > size - offset) {
+			file.clear();
+			return false;
+		}
+
+		std::string read(static_cast<size_t>(length), '\0');
+		if (length > 0 && !file.read(&read[0], static_cast<std::streamsize>(length))) {
+			file.clear();
+			return false;
+		}
+		body = std::move(read);
+		return true;
+	}
+
+	/**
+	 * Return whether the file could be opened
+	 */
+	bool IsOpen() const {
+		return file.is_open();
+	}
+
+	/**
+	 * Return the number of bytes written to the file
+	 */
+	uint64_t Size() const {
+		return size;
+	}
+
+private:
+	std::string          path;
+	mutable std::fstream file;
+	uint64_t             size;
+};
+
+};
+
+#endif
@@ -0,0 +1,147 @@
+#ifndef __SUBSTRING_SEARCH_HPP__
+#define __SUBSTRING_SEARCH_HPP__
+
+#include <string>
+#include <cstring>
+#include <cstddef>
+
+#if defined(__AVX2__)
+#define DATABASE_SEARCH_AVX2
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define DATABASE_SEARCH_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace Database
+{
+
+/**
+ * SubstringSearch finds a fixed pattern inside of a block of text.
+ *
+ * Where the compiler targets AVX2 or SSE2 (and therefore SSE4.2) the
+ * search compares the first and last character of the pattern against
+ * 32 or 16 positions at once, only falling back to a full comparison
+ * for candidate positions. Other targets use a scalar memchr search.
+ */
+class SubstringSearch
+{
+public:
+	static const size_t npos = static_cast<size_t>(-1);
+
+	SubstringSearch(std::string pattern) : pattern(std::move(pattern)) {
+	}
+
+	/**
+	 * Return the pattern being searched for
+	 */
+	const std::string &Pattern(void) const {
+		return pattern;
+	}
+
+	/**
+	 * Find returns the offset of the first occurrence of the pattern
+	 * at or after the offset from, or npos if there is none.
+	 */
+	size_t Find(const char *text, size_t length, size_t from = 0) const {
+		const size_t m = pattern.size();
+		if (from > length || m > length - from) {
+			return npos;
+		}
+		if (m == 0) {
+			return from;
+		}
+
+		size_t i = from;
+
+#if defined(DATABASE_SEARCH_AVX2)
+		const __m256i first = _mm256_set1_epi8(pattern[0]);
+		const __m256i last  = _mm256_set1_epi8(pattern[m - 1]);
+
+		for (; i + m - 1 + 32 <= length; i += 32) {
+			const __m256i blockFirst = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i));
+			const __m256i blockLast  = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text + i + m - 1));
+
+			unsigned int mask = static_cast<unsigned int>(_mm256_movemask_epi8(
+				_mm256_and_si256(_mm256_cmpeq_epi8(first, blockFirst), _mm256_cmpeq_epi8(last, blockLast))));
+
+			while (mask != 0) {
+				size_t candidate = i + lowestBit(mask);
+				if (matchesAt(text, candidate)) {
+					return candidate;
+				}
+				mask &= mask - 1;
+			}
+		}
+#elif defined(DATABASE_SEARCH_SSE2)
+		const __m128i first = _mm_set1_epi8(pattern[0]);
+		const __m128i last  = _mm_set1_epi8(pattern[m - 1]);
+
+		for (; i + m - 1 + 16 <= length; i += 16) {
+			const __m128i blockFirst = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i));
+			const __m128i blockLast  = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + i + m - 1));
+
+			unsigned int mask = static_cast<unsigned int>(_mm_movemask_epi8(
+				_mm_and_si128(_mm_cmpeq_epi8(first, blockFirst), _mm_cmpeq_epi8(last, blockLast))));
+
+			while (mask != 0) {
+				size_t candidate = i + lowestBit(mask);
+				if (matchesAt(text, candidate)) {
+					return candidate;
+				}
+				mask &= mask - 1;
+			}
+		}
+#endif
+
+		// Scalar search, used for the tail of the text (or all of it
+		// when no vector instructions are available)
+		while (i + m <= length) {
+			auto found = static_cast<const char*>(std::memchr(text + i, pattern[0], length - m + 1 - i));
+			if (found == nullptr) {
+				return npos;
+			}
+			i = found - text;
+			if (matchesAt(text, i)) {
+				return i;
+			}
+			++i;
+		}
+		return npos;
+	}
+
+	/**
+	 * Find the pattern within a string
+	 */
+	size_t Find(const std::string &text, size_t from = 0) const {
+		return Find(text.data(), text.size(), from);
+	}
+
+private:
+	// Compare the whole pattern against the text at the given offset
+	bool matchesAt(const char *text, size_t offset) const {
+		return std::memcmp(text + offset, pattern.data(), pattern.size()) == 0;
+	}
+
+	// Return the index of the lowest set bit of a non-zero mask
+	static unsigned int lowestBit(unsigned int mask) {
+#if defined(_MSC_VER)
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return static_cast<unsigned int>(index);
+#else
+		return static_cast<unsigned int>(__builtin_ctz(mask));
+#endif
+	}
+
+private:
+	std::string pattern;
+};
+
+};
+
+#endif
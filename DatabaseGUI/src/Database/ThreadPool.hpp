@@ -0,0 +1,183 @@
+#ifndef __THREAD_POOL_HPP__
+#define __THREAD_POOL_HPP__
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <utility>
+#include <atomic>
+
+namespace Database
+{
+
+/**
+ * The ThreadPool runs tasks on a fixed set of worker threads.
+ *
+ * Each worker has its own queue. A task submitted by a worker goes on
+ * that worker's queue, and is taken from the back, so related work stays
+ * on one thread while its data is still in cache. Tasks submitted from
+ * elsewhere are spread across the queues. A worker whose queue is empty
+ * steals from the front of the others' queues, so no worker sits idle
+ * while another has a backlog.
+ */
+class ThreadPool
+{
+	typedef std::function<void()> Task;
+
+	struct Queue {
+		std::mutex       mutex;
+		std::deque<Task> tasks;
+	};
+
+public:
+	explicit ThreadPool(size_t threads = std::thread::hardware_concurrency()) : pending(0), next(0), stopping(false) {
+		if (threads == 0) {
+			threads = 1;
+		}
+
+		for (size_t i = 0; i < threads; ++i) {
+			queues.emplace_back(new Queue());
+		}
+		for (size_t i = 0; i < threads; ++i) {
+			workers.emplace_back(&ThreadPool::run, this, i);
+		}
+	}
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(sleep);
+			stopping = true;
+		}
+		wake.notify_all();
+
+		for (auto &worker : workers) {
+			worker.join();
+		}
+	}
+
+	ThreadPool(const ThreadPool &) = delete;
+	ThreadPool &operator=(const ThreadPool &) = delete;
+
+	/**
+	 * Submit queues a task, returning a future for its result
+	 */
+	template <class Func>
+	auto Submit(Func func) -> std::future<decltype(func())> {
+		typedef decltype(func()) Result;
+
+		// Tasks must be copyable to be held in a std::function
+		auto task = std::make_shared<std::packaged_task<Result()>>(std::move(func));
+		std::future<Result> result = task->get_future();
+
+		// Workers keep their own tasks, others are spread out
+		size_t self = current();
+		size_t queue = self != npos ? self : next++ % queues.size();
+		{
+			std::lock_guard<std::mutex> lock(queues[queue]->mutex);
+			queues[queue]->tasks.emplace_back([task] { (*task)(); });
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(sleep);
+			++pending;
+		}
+		wake.notify_one();
+
+		return result;
+	}
+
+	/**
+	 * Return the number of worker threads
+	 */
+	size_t Size() const {
+		return workers.size();
+	}
+
+private:
+	static const size_t npos = static_cast<size_t>(-1);
+
+	void run(size_t self) {
+		worker().pool = this;
+		worker().index = self;
+
+		for (;;) {
+			{
+				std::unique_lock<std::mutex> lock(sleep);
+				wake.wait(lock, [&] { return stopping || pending > 0; });
+				if (pending == 0) {
+					return;
+				}
+			}
+
+			Task task;
+			if (take(self, task)) {
+				{
+					std::lock_guard<std::mutex> lock(sleep);
+					--pending;
+				}
+				task();
+			}
+		}
+	}
+
+	// Take a task from the back of a worker's own queue, or else
+	// steal one from the front of another's
+	bool take(size_t self, Task &task) {
+		{
+			Queue &own = *queues[self];
+			std::lock_guard<std::mutex> lock(own.mutex);
+			if (!own.tasks.empty()) {
+				task = std::move(own.tasks.back());
+				own.tasks.pop_back();
+				return true;
+			}
+		}
+
+		for (size_t i = 1; i < queues.size(); ++i) {
+			Queue &other = *queues[(self + i) % queues.size()];
+			std::lock_guard<std::mutex> lock(other.mutex);
+			if (!other.tasks.empty()) {
+				task = std::move(other.tasks.front());
+				other.tasks.pop_front();
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// The pool and queue of the calling thread, if it is a worker
+	struct Worker {
+		const ThreadPool *pool;
+		size_t            index;
+	};
+
+	static Worker &worker() {
+		thread_local Worker self = { nullptr, npos };
+		return self;
+	}
+
+	// The index of the calling thread within this pool, or npos if it
+	// isn't one of this pool's workers
+	size_t current() const {
+		return worker().pool == this ? worker().index : npos;
+	}
+
+private:
+	std::vector<std::unique_ptr<Queue>> queues;
+	std::vector<std::thread>            workers;
+
+	std::mutex              sleep;
+	std::condition_variable wake;
+	size_t                  pending;
+	std::atomic<size_t>     next;
+	bool                    stopping;
+};
+
+};
+
+#endif
@@ -0,0 +1,218 @@
+#ifndef __TRACE_HPP__
+#define __TRACE_HPP__
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <cstdio>
+#include <cstdint>
+
+namespace Database
+{
+
+/**
+ * Trace records spans of time spent in named operations (see TraceSpan),
+ * for finding out where a slow action spent its time. A trace can be
+ * exported as Chrome trace-event JSON, to be viewed in a trace viewer
+ * such as chrome://tracing or Perfetto.
+ *
+ * Each thread records into a ring buffer of its own, keeping its most
+ * recent spans, without taking any lock. The buffers may be exported
+ * while spans are being recorded; a span being written at that moment
+ * is skipped.
+ *
+ * Tracing is off until enabled, when a span costs a single check. It
+ * can also be compiled out altogether by defining DATABASE_NO_TRACE.
+ */
+class Trace
+{
+public:
+	// Spans kept by each thread, the oldest being overwritten
+	enum { BufferSize = 16384 };
+
+	static void Enable(bool enable = true) {
+		enabled().store(enable, std::memory_order_relaxed);
+	}
+
+	static bool Enabled() {
+		return enabled().load(std::memory_order_relaxed);
+	}
+
+	/**
+	 * Now returns nanoseconds since the trace clock started
+	 */
+	static uint64_t Now() {
+		static const auto epoch = std::chrono::steady_clock::now();
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count());
+	}
+
+	/**
+	 * Record a span on the calling thread. The name must be a string
+	 * literal, or otherwise outlive the trace.
+	 */
+	static void Record(const char *name, uint64_t start, uint64_t duration) {
+		Buffer &buffer = local();
+		uint64_t index = buffer.head.load(std::memory_order_relaxed);
+		Slot &slot = buffer.slots[index % BufferSize];
+
+		// The sequence is odd while a slot is being written
+		slot.sequence.store(2 * index + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		slot.name.store(name, std::memory_order_relaxed);
+		slot.start.store(start, std::memory_order_relaxed);
+		slot.duration.store(duration, std::memory_order_relaxed);
+		slot.sequence.store(2 * index + 2, std::memory_order_release);
+
+		buffer.head.store(index + 1, std::memory_order_release);
+	}
+
+	/**
+	 * Clear forgets every span recorded so far
+	 */
+	static void Clear() {
+		std::lock_guard<std::mutex> lock(registry().mutex);
+		for (auto &buffer : registry().buffers) {
+			buffer->tail.store(buffer->head.load(std::memory_order_acquire), std::memory_order_relaxed);
+		}
+	}
+
+	/**
+	 * Export writes the recorded spans as Chrome trace-event JSON, a
+	 * complete ("X") event per span on the thread that recorded it
+	 */
+	static void Export(std::ostream &out) {
+		std::lock_guard<std::mutex> lock(registry().mutex);
+
+		out << "{\"traceEvents\":[";
+		bool first = true;
+		for (auto &buffer : registry().buffers) {
+			uint64_t head = buffer->head.load(std::memory_order_acquire);
+			uint64_t tail = buffer->tail.load(std::memory_order_relaxed);
+			uint64_t begin = head - tail > BufferSize ? head - BufferSize : tail;
+
+			for (uint64_t index = begin; index < head; ++index) {
+				const Slot &slot = buffer->slots[index % BufferSize];
+				uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+				const char *name = slot.name.load(std::memory_order_relaxed);
+				uint64_t start = slot.start.load(std::memory_order_relaxed);
+				uint64_t duration = slot.duration.load(std::memory_order_relaxed);
+				std::atomic_thread_fence(std::memory_order_acquire);
+
+				// Skip spans overwritten while being read
+				if (sequence != 2 * index + 2 || slot.sequence.load(std::memory_order_relaxed) != sequence) {
+					continue;
+				}
+
+				char times[64];
+				std::snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f", start / 1000.0, duration / 1000.0);
+
+				out << (first ? "" : ",") << "\n{\"name\":\"";
+				writeEscaped(out, name);
+				out << "\",\"ph\":\"X\"," << times << ",\"pid\":1,\"tid\":" << buffer->thread << "}";
+				first = false;
+			}
+		}
+		out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	}
+
+private:
+	struct Slot {
+		std::atomic<uint64_t>    sequence;
+		std::atomic<const char*> name;
+		std::atomic<uint64_t>    start;
+		std::atomic<uint64_t>    duration;
+	};
+
+	struct Buffer {
+		explicit Buffer(unsigned int thread) : slots(new Slot[BufferSize]), head(0), tail(0), thread(thread) {
+			for (size_t i = 0; i < BufferSize; ++i) {
+				slots[i].sequence.store(0, std::memory_order_relaxed);
+			}
+		}
+
+		std::unique_ptr<Slot[]> slots;
+		std::atomic<uint64_t>   head; // Written only by the owning thread
+		std::atomic<uint64_t>   tail; // Spans before this have been cleared
+		unsigned int            thread;
+	};
+
+	// Every thread's buffer, kept after the thread ends so that its
+	// spans can still be exported
+	struct Registry {
+		std::mutex                           mutex;
+		std::vector<std::shared_ptr<Buffer>> buffers;
+	};
+
+	static std::atomic<bool> &enabled() {
+		static std::atomic<bool> flag(false);
+		return flag;
+	}
+
+	static Registry &registry() {
+		static Registry registry;
+		return registry;
+	}
+
+	// The calling thread's buffer, registered on first use
+	static Buffer &local() {
+		thread_local std::shared_ptr<Buffer> buffer;
+		if (!buffer) {
+			std::lock_guard<std::mutex> lock(registry().mutex);
+			buffer = std::make_shared<Buffer>(static_cast<unsigned int>(registry().buffers.size() + 1));
+			registry().buffers.push_back(buffer);
+		}
+		return *buffer;
+	}
+
+	static void writeEscaped(std::ostream &out, const char *text) {
+		for (; *text != '\0'; ++text) {
+			unsigned char c = static_cast<unsigned char>(*text);
+			if (c == '"' || c == '\\') {
+				out << '\\' << *text;
+			} else if (c < 0x20) {
+				char escaped[8];
+				std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+				out << escaped;
+			} else {
+				out << *text;
+			}
+		}
+	}
+};
+
+/**
+ * A TraceSpan records the time from its construction to its
+ * destruction, under a name, while tracing is enabled (see Trace)
+ */
+class TraceSpan
+{
+public:
+#if defined(DATABASE_NO_TRACE)
+	explicit TraceSpan(const char *) {
+	}
+#else
+	explicit TraceSpan(const char *name) : name(Trace::Enabled() ? name : nullptr), start(this->name != nullptr ? Trace::Now() : 0) {
+	}
+
+	~TraceSpan() {
+		if (name != nullptr) {
+			Trace::Record(name, start, Trace::Now() - start);
+		}
+	}
+
+private:
+	const char *name;
+	uint64_t    start;
+#endif
+
+public:
+	TraceSpan(const TraceSpan &) = delete;
+	TraceSpan &operator=(const TraceSpan &) = delete;
+};
+
+};
+
+#endif
@@ -0,0 +1,544 @@
+#ifndef __WORKLOAD_HPP__
+#define __WORKLOAD_HPP__
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <iterator>
+#include <istream>
+#include <ostream>
+#include <cstdio>
+#include <cctype>
+#include <cstdint>
+
+#include "ResearchDocumentRepository.hpp"
+#include "Serialization.hpp"
+
+namespace Database
+{
+
+/**
+ * The operations of a workload, as recorded by a WorkloadRecorder
+ */
+enum class WorkloadOperation : uint8_t {
+	Load,         // A document already stored when recording started
+	Add,
+	Remove,
+	Update,
+	FindByTitle,
+	FindByAuthor,
+	FindMatching,
+	Facets,       // The sidebar's counts, of everything or of the last match
+	Count
+};
+
+inline const char *WorkloadOperationName(WorkloadOperation operation) {
+	static const char *names[] = { "Load", "Add", "Remove", "Update", "FindByTitle", "FindByAuthor", "FindMatching", "Facets" };
+	return operation < WorkloadOperation::Count ? names[static_cast<size_t>(operation)] : "Unknown";
+}
+
+/**
+ * A WorkloadRecord is a single operation of a workload, with the
+ * arguments it was made with
+ */
+struct WorkloadRecord
+{
+	WorkloadOperation operation;
+	Document          document; // Load, Add and Update; only the id for Remove
+	std::string       key;      // Title, author or query of a find
+	bool              within;   // Whether Facets counted only the last match
+
+	WorkloadRecord() : operation(WorkloadOperation::Load), document(0, "", "", ""), within(false) {
+	}
+
+	/**
+	 * Write the record. Anonymized records carry the length of a body
+	 * rather than the body itself.
+	 */
+	void Write(BinaryWriter &out, bool anonymized) const {
+		out.Write(static_cast<uint8_t>(operation));
+
+		switch (operation) {
+		case WorkloadOperation::Load:
+		case WorkloadOperation::Add:
+		case WorkloadOperation::Update:
+			out.Write<uint32_t>(document.Id());
+			out.Write<int64_t>(document.Published());
+			out.WriteString(document.Title());
+			out.Write<uint32_t>(static_cast<uint32_t>(document.Authors().size()));
+			for (auto &author : document.Authors()) {
+				out.WriteString(author);
+			}
+			if (anonymized) {
+				out.Write<uint32_t>(static_cast<uint32_t>(document.Body().size()));
+			} else {
+				out.WriteString(document.Body());
+			}
+			break;
+
+		case WorkloadOperation::Remove:
+			out.Write<uint32_t>(document.Id());
+			break;
+
+		case WorkloadOperation::FindByTitle:
+		case WorkloadOperation::FindByAuthor:
+		case WorkloadOperation::FindMatching:
+			out.WriteString(key);
+			break;
+
+		case WorkloadOperation::Facets:
+		default:
+			out.Write<uint8_t>(within ? 1 : 0);
+			break;
+		}
+	}
+
+	/**
+	 * Read the next record, returning false at the end of the workload
+	 * or if the record is incomplete or damaged. The bodies of anonymized
+	 * records are filled with made up text of their original length.
+	 */
+	bool Read(BinaryReader &in, bool anonymized) {
+		uint8_t kind = 0;
+		if (!in.Read(kind) || kind >= static_cast<uint8_t>(WorkloadOperation::Count)) {
+			return false;
+		}
+		operation = static_cast<WorkloadOperation>(kind);
+		key.clear();
+		within = false;
+
+		uint32_t id = 0;
+		switch (operation) {
+		case WorkloadOperation::Load:
+		case WorkloadOperation::Add:
+		case WorkloadOperation::Update: {
+			int64_t published = 0;
+			std::string title, body;
+			uint32_t authors = 0;
+			in.Read(id);
+			in.Read(published);
+			in.ReadString(title);
+			in.Read(authors);
+
+			document = Document(id, "", std::move(title), "", static_cast<std::time_t>(published));
+			document.Authors().clear();
+			for (uint32_t i = 0; i < authors && !in.Failed(); ++i) {
+				std::string author;
+				in.ReadString(author);
+				document.Authors().push_back(std::move(author));
+			}
+
+			if (anonymized) {
+				uint32_t length = 0;
+				if (in.Read(length) && length <= 1u << 30) {
+					body = fillerText(id, length);
+				}
+			} else {
+				in.ReadString(body);
+			}
+			document.SetBody(std::move(body));
+			break;
+		}
+
+		case WorkloadOperation::Remove:
+			in.Read(id);
+			document = Document(id, "", "", "");
+			break;
+
+		case WorkloadOperation::FindByTitle:
+		case WorkloadOperation::FindByAuthor:
+		case WorkloadOperation::FindMatching:
+			in.ReadString(key);
+			break;
+
+		case WorkloadOperation::Facets:
+		default: {
+			uint8_t flag = 0;
+			in.Read(flag);
+			within = flag != 0;
+			break;
+		}
+		}
+		return !in.Failed();
+	}
+
+private:
+	// Made up words filling a body of a given length, differing by id
+	static std::string fillerText(unsigned int id, size_t length) {
+		std::string text;
+		text.reserve(length);
+
+		uint64_t state = id;
+		while (text.size() < length) {
+			state += 0x9e3779b97f4a7c15ull;
+			uint64_t bits = (state ^ (state >> 31)) * 0xbf58476d1ce4e5b9ull;
+			for (size_t letters = 2 + bits % 7; letters > 0 && text.size() < length; --letters) {
+				bits = bits / 26 + 0x9e37;
+				text += static_cast<char>('a' + bits % 26);
+			}
+			if (text.size() < length) {
+				text += ' ';
+			}
+		}
+		return text;
+	}
+};
+
+/**
+ * The WorkloadRecorder writes the operations made on a repository to a
+ * stream, as a compact binary workload that a WorkloadReplay can run
+ * again, for comparing the performance of builds on a real session.
+ *
+ * The workload starts with a Load record for each document already
+ * stored. Changes are recorded as they are made; finds are recorded by
+ * whoever makes them, through Find and Facets.
+ *
+ * An anonymized workload keeps the shape of the data without its
+ * content: each word of a title, author or query is replaced by made up
+ * letters of the same length, and bodies are recorded by their length
+ * only. Words are replaced a letter at a time, each depending on the
+ * letters before it, so a query still finds the documents it found
+ * before, prefixes and all. The recorder must be destroyed before the
+ * repository.
+ */
+class WorkloadRecorder
+{
+public:
+	WorkloadRecorder(ResearchDocumentRepository &repository, std::ostream &out, bool anonymize = false) : repository(repository), out(out), anonymize(anonymize), count(0) {
+		out.write(Magic(), 4);
+		BinaryWriter header;
+		header.Write<uint32_t>(Version());
+		header.Write<uint8_t>(anonymize ? 1 : 0);
+		out.write(header.Buffer().data(), header.Buffer().size());
+
+		for (auto &document : repository.FindAll()) {
+			write(WorkloadOperation::Load, &document, std::string(), false);
+		}
+		out.flush();
+
+		handle = repository.Listen([this](ResearchDocumentRepository::Change change, const Document &document) {
+			switch (change) {
+			case ResearchDocumentRepository::Change::Added:   record(WorkloadOperation::Add, &document, std::string(), false); break;
+			case ResearchDocumentRepository::Change::Removed: record(WorkloadOperation::Remove, &document, std::string(), false); break;
+			case ResearchDocumentRepository::Change::Updated: record(WorkloadOperation::Update, &document, std::string(), false); break;
+			}
+		});
+	}
+
+	~WorkloadRecorder() {
+		repository.Unlisten(handle);
+	}
+
+	WorkloadRecorder(const WorkloadRecorder &) = delete;
+	WorkloadRecorder &operator=(const WorkloadRecorder &) = delete;
+
+	static const char *Magic() {
+		return "DBWL";
+	}
+
+	static uint32_t Version() {
+		return 1;
+	}
+
+	/**
+	 * Find records a FindByTitle, FindByAuthor or FindMatching, by its key
+	 */
+	void Find(WorkloadOperation operation, const std::string &key) {
+		record(operation, nullptr, key, false);
+	}
+
+	/**
+	 * Facets records the sidebar's counts being taken, of every document
+	 * or only of those the last FindMatching found
+	 */
+	void Facets(bool withinMatching) {
+		record(WorkloadOperation::Facets, nullptr, std::string(), withinMatching);
+	}
+
+	/**
+	 * Return the number of records written
+	 */
+	size_t Size() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		return count;
+	}
+
+	/**
+	 * Anonymize replaces each word of some text with made up lower case
+	 * letters, leaving everything else as it was. A letter depends only
+	 * on the letters of its word up to it, so prefixes stay prefixes.
+	 */
+	static std::string Anonymize(const std::string &text) {
+		std::string result(text);
+		uint64_t hash = 0;
+		for (char &c : result) {
+			unsigned char u = static_cast<unsigned char>(c);
+			if (u >= 0x80 || std::isalnum(u)) {
+				char lower = static_cast<char>(std::tolower(u));
+				hash = Checksum(&lower, 1, hash == 0 ? 14695981039346656037ull : hash);
+				c = static_cast<char>('a' + (hash >> 32) % 26);
+			} else {
+				hash = 0;
+			}
+		}
+		return result;
+	}
+
+private:
+	void record(WorkloadOperation operation, const Document *document, const std::string &key, bool within) {
+		std::lock_guard<std::mutex> lock(mutex);
+		write(operation, document, key, within);
+		out.flush();
+	}
+
+	void write(WorkloadOperation operation, const Document *document, const std::string &key, bool within) {
+		WorkloadRecord record;
+		record.operation = operation;
+		record.within = within;
+		record.key = anonymize ? Anonymize(key) : key;
+		if (document != nullptr) {
+			record.document = *document;
+			if (anonymize) {
+				record.document.SetTitle(Anonymize(document->Title()));
+				for (auto &author : record.document.Authors()) {
+					author = Anonymize(author);
+				}
+			}
+		}
+
+		BinaryWriter bytes;
+		record.Write(bytes, anonymize);
+		out.write(bytes.Buffer().data(), bytes.Buffer().size());
+		++count;
+	}
+
+private:
+	ResearchDocumentRepository &repository;
+	std::ostream &out;
+	bool anonymize;
+
+	mutable std::mutex mutex;
+	size_t             count;
+	unsigned int       handle;
+};
+
+/**
+ * The WorkloadReplay runs a recorded workload against a repository as
+ * fast as it can, timing each operation, and reports the distribution
+ * of latencies of each kind of operation.
+ *
+ * The whole workload is read before it's run, so that reading doesn't
+ * count towards the operations' times.
+ */
+class WorkloadReplay
+{
+public:
+	/**
+	 * The latencies of one kind of operation, in nanoseconds
+	 */
+	struct Latencies {
+		WorkloadOperation operation;
+		size_t            count;
+		size_t            failed; // Changes the repository rejected
+		uint64_t          total;
+		uint64_t          p50, p90, p99, max;
+	};
+
+	explicit WorkloadReplay(ResearchDocumentRepository &repository) : repository(repository), anonymized(false), complete(false), samples(static_cast<size_t>(WorkloadOperation::Count)), failures(samples.size(), 0), results(0) {
+	}
+
+	/**
+	 * Read a workload. Returns false if it isn't a workload. A workload
+	 * cut short (by the recording process ending) is read up to its last
+	 * whole record; see Complete.
+	 */
+	bool Read(std::istream &in) {
+		std::string bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+		if (bytes.size() < 4 || bytes.compare(0, 4, WorkloadRecorder::Magic()) != 0) {
+			return false;
+		}
+
+		BinaryReader reader(bytes.data() + 4, bytes.size() - 4);
+		uint32_t version = 0;
+		uint8_t flags = 0;
+		if (!reader.Read(version) || version != WorkloadRecorder::Version() || !reader.Read(flags)) {
+			return false;
+		}
+		anonymized = flags != 0;
+
+		records.clear();
+		complete = true;
+		WorkloadRecord record;
+		while (reader.Remaining() > 0) {
+			if (!record.Read(reader, anonymized)) {
+				complete = false;
+				break;
+			}
+			records.push_back(std::move(record));
+		}
+		return true;
+	}
+
+	/**
+	 * Run every operation of the workload, in order
+	 */
+	void Run() {
+		for (auto &record : records) {
+			run(record);
+		}
+	}
+
+	/**
+	 * Return the number of operations in the workload
+	 */
+	size_t Size() const {
+		return records.size();
+	}
+
+	bool Anonymized() const {
+		return anonymized;
+	}
+
+	/**
+	 * Return whether the whole workload was read, rather than stopping
+	 * at a record cut short or damaged
+	 */
+	bool Complete() const {
+		return complete;
+	}
+
+	/**
+	 * Return the latencies of each kind of operation that was run
+	 */
+	std::vector<Latencies> Summary() const {
+		std::vector<Latencies> summary;
+		for (size_t i = 0; i < samples.size(); ++i) {
+			if (samples[i].empty()) {
+				continue;
+			}
+
+			std::vector<uint64_t> sorted(samples[i]);
+			std::sort(sorted.begin(), sorted.end());
+
+			Latencies latencies;
+			latencies.operation = static_cast<WorkloadOperation>(i);
+			latencies.count = sorted.size();
+			latencies.failed = failures[i];
+			latencies.total = 0;
+			for (uint64_t sample : sorted) {
+				latencies.total += sample;
+			}
+			latencies.p50 = percentile(sorted, 50);
+			latencies.p90 = percentile(sorted, 90);
+			latencies.p99 = percentile(sorted, 99);
+			latencies.max = sorted.back();
+			summary.push_back(latencies);
+		}
+		return summary;
+	}
+
+	/**
+	 * Report writes the summary as a table, in microseconds
+	 */
+	void Report(std::ostream &out) const {
+		char line[160];
+		std::snprintf(line, sizeof(line), "%-14s %8s %7s %10s %10s %10s %10s %10s\n", "operation", "count", "failed", "mean", "p50", "p90", "p99", "max");
+		out << line;
+		for (auto &latencies : Summary()) {
+			std::snprintf(line, sizeof(line), "%-14s %8zu %7zu %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+				WorkloadOperationName(latencies.operation), latencies.count, latencies.failed,
+				latencies.total / 1000.0 / latencies.count, latencies.p50 / 1000.0, latencies.p90 / 1000.0, latencies.p99 / 1000.0, latencies.max / 1000.0);
+			out << line;
+		}
+	}
+
+private:
+	void run(const WorkloadRecord &record) {
+		// Arguments are prepared before the clock starts
+		Document document = record.document;
+		unsigned int id = document.Id();
+		bool ok = true;
+
+		auto start = std::chrono::steady_clock::now();
+		switch (record.operation) {
+		case WorkloadOperation::Load:
+		case WorkloadOperation::Add:
+			ok = repository.Add(std::move(document));
+			break;
+
+		case WorkloadOperation::Remove: {
+			auto found = repository.FindOneById(id);
+			ok = found != nullptr && repository.Remove(*found);
+			break;
+		}
+
+		case WorkloadOperation::Update:
+			ok = repository.Update(id, [&](Document &stored) {
+				stored = std::move(document);
+			});
+			break;
+
+		case WorkloadOperation::FindByTitle:
+			keep(repository.FindManyByTitle(record.key).size());
+			break;
+
+		case WorkloadOperation::FindByAuthor:
+			keep(repository.FindManyByAuthor(record.key).size());
+			break;
+
+		case WorkloadOperation::FindMatching:
+			matching = repository.FindMatching(record.key);
+			break;
+
+		case WorkloadOperation::Facets:
+		default:
+			keep(record.within ? repository.MostProlificAuthors(10, within).size() + repository.CountByYear(within).size()
+			                   : repository.MostProlificAuthors(10).size() + repository.CountByYear().size());
+			break;
+		}
+		auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+		size_t kind = static_cast<size_t>(record.operation);
+		samples[kind].push_back(static_cast<uint64_t>(elapsed));
+		if (!ok) {
+			++failures[kind];
+		}
+
+		// Later facets count within what was found
+		if (record.operation == WorkloadOperation::FindMatching) {
+			within = IdSet();
+			for (auto found : matching) {
+				within.Insert(found->Id());
+			}
+		}
+	}
+
+	// Keep a result, so that the query isn't optimised away
+	void keep(size_t size) {
+		results += size;
+	}
+
+	static uint64_t percentile(const std::vector<uint64_t> &sorted, size_t percent) {
+		size_t rank = (sorted.size() * percent + 99) / 100;
+		return sorted[rank == 0 ? 0 : rank - 1];
+	}
+
+private:
+	ResearchDocumentRepository &repository;
+	std::vector<WorkloadRecord> records;
+	bool                        anonymized;
+	bool                        complete;
+
+	std::vector<std::vector<uint64_t>> samples; // By operation
+	std::vector<size_t>                failures;
+
+	std::vector<const Document*> matching;
+	IdSet                        within;
+	volatile size_t              results;
+};
+
+};
+
+#endif
@@ -1,151 +1,288 @@
-#ifndef DOCUMENT_TABLE_MODEL_H
-#define DOCUMENT_TABLE_MODEL_H
-
-#include <vector>
-#include <sstream>
-#include <iterator>
-#include <algorithm>
-#include <functional>
-#include <string>
-
-#include <QAbstractTableModel>
-#include <QDateTime>
-#include "Database/Document.hpp"
-
-/**
- * The DocumentTableModel represents a Document as a row
- * inside of Qt's table view.
- */
-class DocumentTableModel : public QAbstractTableModel
-{
-    Q_OBJECT
-
-private:
-	// Names for each column
-	enum Columns {
-		Id,
-		Title,
-		Authors,
-		Published
-	};
-
-public:
-    DocumentTableModel(const std::vector<const Database::Document> documents, QObject *parent) : QAbstractTableModel(parent), documents(documents)
-	{
-	}
-
-    int rowCount(const QModelIndex &parent = QModelIndex()) const
-	{
-		// The row count is always the number of documents we have stored
-		return documents.size();
-	}
-
-    int columnCount(const QModelIndex &parent = QModelIndex()) const
-	{
-		// Column count is fixed to 4 (Id, Title, Author(s), Published)
-		return 4;
-	}
-
-	/**
-	 * Document returns the document found at a table's row index
-	 */
-	const Database::Document Document(const QModelIndex &index) const
-	{
-		return documents[index.row()];
-	}
-
-	/**
-	 * Return data for the requested display role.
-	 */
-    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const
-	{
-		if (role == Qt::DisplayRole)
-		{
-			int row = index.row();
-			int col = index.column();
-
-			// Return displayed information based upon the column
-			switch (col)
-			{
-			case Columns::Id:
-				return QVariant(documents[row].Id());
-
-			case Columns::Title:
-				return QString::fromStdString((documents[row].Title()));
-
-			case Columns::Authors:
-				{
-					QStringList list;
-					for (auto &author : documents[row].Authors()) {
-						list.push_back(QString::fromStdString(author));
-					}
-					return list.join(", ");
-				}
-
-			case Columns::Published:
-				return QDateTime::fromTime_t(documents[row].Published()).date().toString(Qt::DateFormat::DefaultLocaleShortDate);
-			}
-		}
-		return QVariant();
-	}
-
-	/**
-	 * Return header data for the requested display role.
-	 */
-    QVariant headerData(int section, Qt::Orientation orientation, int role) const
-	{
-		if (role == Qt::DisplayRole)
-		{
-			if (orientation == Qt::Horizontal) {
-				// Display header names for each column
-				switch (section)
-				{
-				case Columns::Id:        return QString("Id");
-				case Columns::Title:     return QString("Title");
-				case Columns::Authors:   return QString("Author(s)");
-				case Columns::Published: return QString("Published");
-				}
-			}
-		}
-		return QVariant();
-	}
-	
-	void sort(int column, Qt::SortOrder order = Qt::AscendingOrder)
-	{
-		// An array of sort functions, indexed by column
-		std::function<bool(const Database::Document, const Database::Document)> func[] = {
-			/* Columns::Id */
-			[&](const Database::Document a, const Database::Document b){
-				return (order == Qt::AscendingOrder) ? a.Id() < b.Id() : a.Id() > b.Id();
-			},
-
-			/* Columns::Title */
-			[&](const Database::Document a, const Database::Document b){
-				return (order == Qt::AscendingOrder) ? a.Title() < b.Title() : a.Title() > b.Title();
-			},
-
-			/* Columns::Authors */
-			[&](const Database::Document a, const Database::Document b){
-				return (order == Qt::AscendingOrder) ? a.Authors() < b.Authors() : a.Authors() > b.Authors();
-			},
-
-			/* Columns::Published */
-			[&](const Database::Document a, const Database::Document b){
-				return (order == Qt::AscendingOrder) ? a.Published() < b.Published() : a.Published() > b.Published();
-			},
-		};
-
-		// Sort using sort functions (func[column])
-		std::sort(documents.begin(), documents.end(), func[column]);
-
-		// Tell view that the data has changed
-		QModelIndex topLeft = createIndex(0, 0);
-		QModelIndex bottomRight = createIndex(documents.size() - 1, 2);
-		emit dataChanged(topLeft, bottomRight);
-	}
-
-private:
-	std::vector<const Database::Document> documents;
-};
-
+#ifndef DOCUMENT_TABLE_MODEL_H
+#define DOCUMENT_TABLE_MODEL_H
+
+#include <vector>
+#include <sstream>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <utility>
+#include <cstdint>
+
+#include <QAbstractTableModel>
+#include <QDateTime>
+#include "Database/Document.hpp"
+#include "Database/MetadataColumns.hpp"
+#include "Database/Trace.hpp"
+
+/**
+ * The DocumentTableModel represents a Document as a row
+ * inside of Qt's table view.
+ *
+ * Given the repository's metadata columns (see SortWith), rows are
+ * sorted by keys taken from the columns, rather than by comparing
+ * the documents themselves.
+ */
+class DocumentTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+private:
+	// Names for each column
+	enum Columns {
+		Id,
+		Title,
+		Authors,
+		Published,
+		Count
+	};
+
+public:
+	/**
+	 * The model is created from any view of documents (see Database::ResultView),
+	 * holding only pointers to the documents themselves. The documents must
+	 * outlive the model.
+	 */
+	template <class View>
+	DocumentTableModel(const View &view, QObject *parent) : QAbstractTableModel(parent), columns(nullptr)
+	{
+		rows.reserve(view.size());
+		for (auto &document : view) {
+			rows.push_back(Row(&document));
+		}
+	}
+
+	/**
+	 * The model may also be created from the results of a search
+	 * (see Database::ResearchDocumentRepository::FindMatching)
+	 */
+	DocumentTableModel(const std::vector<const Database::Document*> &documents, QObject *parent) : QAbstractTableModel(parent), columns(nullptr)
+	{
+		rows.reserve(documents.size());
+		for (auto document : documents) {
+			rows.push_back(Row(document));
+		}
+	}
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const
+	{
+		// The row count is always the number of documents we have stored
+		return rows.size();
+	}
+
+    int columnCount(const QModelIndex &parent = QModelIndex()) const
+	{
+		// Column count is fixed to 4 (Id, Title, Author(s), Published)
+		return Columns::Count;
+	}
+
+	/**
+	 * SortWith sorts by the metadata columns of the documents' repository
+	 * (see Database::ResearchDocumentRepository::Columns), which must
+	 * outlive the model
+	 */
+	void SortWith(const Database::MetadataColumns *columns)
+	{
+		this->columns = columns;
+	}
+
+	/**
+	 * Document returns the document found at a table's row index
+	 */
+	const Database::Document &Document(const QModelIndex &index) const
+	{
+		return *rows[index.row()].document;
+	}
+
+	/**
+	 * Return data for the requested display role.
+	 *
+	 * A row's text is rendered the first time any of its cells is shown,
+	 * and kept for as long as the model, so repainting a cell is a lookup.
+	 * The model is recreated whenever the documents change.
+	 */
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const
+	{
+		Database::TraceSpan span("DocumentTableModel::data");
+
+		if (role == Qt::DisplayRole)
+		{
+			const Row &row = rows[index.row()];
+			if (!row.rendered) {
+				render(row);
+			}
+			return row.cells[index.column()];
+		}
+		return QVariant();
+	}
+
+	/**
+	 * Return header data for the requested display role.
+	 */
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const
+	{
+		if (role == Qt::DisplayRole)
+		{
+			if (orientation == Qt::Horizontal) {
+				// Display header names for each column
+				switch (section)
+				{
+				case Columns::Id:        return QString("Id");
+				case Columns::Title:     return QString("Title");
+				case Columns::Authors:   return QString("Author(s)");
+				case Columns::Published: return QString("Published");
+				}
+			}
+		}
+		return QVariant();
+	}
+	
+	void sort(int column, Qt::SortOrder order = Qt::AscendingOrder)
+	{
+		Database::TraceSpan span("DocumentTableModel::sort");
+
+		// An array of sort functions, indexed by column
+		std::function<bool(const Database::Document*, const Database::Document*)> func[] = {
+			/* Columns::Id */
+			[&](const Database::Document *a, const Database::Document *b){
+				return (order == Qt::AscendingOrder) ? a->Id() < b->Id() : a->Id() > b->Id();
+			},
+
+			/* Columns::Title */
+			[&](const Database::Document *a, const Database::Document *b){
+				return (order == Qt::AscendingOrder) ? a->Title() < b->Title() : a->Title() > b->Title();
+			},
+
+			/* Columns::Authors */
+			[&](const Database::Document *a, const Database::Document *b){
+				return (order == Qt::AscendingOrder) ? a->Authors() < b->Authors() : a->Authors() > b->Authors();
+			},
+
+			/* Columns::Published */
+			[&](const Database::Document *a, const Database::Document *b){
+				return (order == Qt::AscendingOrder) ? a->Published() < b->Published() : a->Published() > b->Published();
+			},
+		};
+
+		// Sort using sort functions (func[column]), rows taking their
+		// rendered text with them
+		if (columns == nullptr || !sortByColumns(column, order)) {
+			std::sort(rows.begin(), rows.end(), [&](const Row &a, const Row &b) {
+				return func[column](a.document, b.document);
+			});
+		}
+
+		// Tell view that the data has changed
+		QModelIndex topLeft = createIndex(0, 0);
+		QModelIndex bottomRight = createIndex(rows.size() - 1, Columns::Count - 1);
+		emit dataChanged(topLeft, bottomRight);
+	}
+
+private:
+	// A document, and the text displayed in each of its cells once rendered
+	struct Row {
+		explicit Row(const Database::Document *document) : document(document), rendered(false) {
+		}
+
+		const Database::Document *document;
+		mutable bool              rendered;
+		mutable QVariant          cells[Columns::Count];
+	};
+
+	// Sort the rows by keys taken from the metadata columns, in the same
+	// order as the sort functions. Returns false, leaving the rows as they
+	// were, if a document isn't in the columns.
+	bool sortByColumns(int column, Qt::SortOrder order)
+	{
+		// Each row's key, and its place in the columns and the rows
+		struct Key {
+			int64_t  value;
+			uint32_t at;
+			uint32_t row;
+		};
+
+		std::vector<Key> keys(rows.size());
+		for (size_t i = 0; i < rows.size(); ++i) {
+			size_t at = columns->Row(rows[i].document->Id());
+			if (at == Database::MetadataColumns::npos) {
+				return false;
+			}
+			keys[i].at = static_cast<uint32_t>(at);
+			keys[i].row = static_cast<uint32_t>(i);
+		}
+
+		// Take the key of each row from just the column needed
+		std::vector<uint32_t> ranks;
+		switch (column) {
+		case Columns::Id:
+			for (auto &key : keys) {
+				key.value = columns->Ids()[key.at];
+			}
+			break;
+		case Columns::Published:
+			for (auto &key : keys) {
+				key.value = columns->Published()[key.at];
+			}
+			break;
+		case Columns::Authors:
+			ranks = columns->AuthorRanks();
+			for (auto &key : keys) {
+				key.value = ranks[columns->FirstAuthors()[key.at]];
+			}
+			break;
+		default:
+			break;
+		}
+
+		// Titles are compared in the shared text, and authors after the
+		// first only when the first are the same
+		auto less = [&](const Key &a, const Key &b) {
+			switch (column) {
+			case Columns::Title:
+				return columns->CompareTitles(a.at, b.at) < 0;
+			case Columns::Authors:
+				return a.value < b.value || (a.value == b.value && rows[a.row].document->Authors() < rows[b.row].document->Authors());
+			default:
+				return a.value < b.value;
+			}
+		};
+
+		if (order == Qt::AscendingOrder) {
+			std::sort(keys.begin(), keys.end(), less);
+		} else {
+			std::sort(keys.begin(), keys.end(), [&](const Key &a, const Key &b) { return less(b, a); });
+		}
+
+		std::vector<Row> sorted;
+		sorted.reserve(rows.size());
+		for (auto &key : keys) {
+			sorted.push_back(std::move(rows[key.row]));
+		}
+		rows.swap(sorted);
+		return true;
+	}
+
+	static void render(const Row &row)
+	{
+		const Database::Document &document = *row.document;
+
+		QStringList authors;
+		for (auto &author : document.Authors()) {
+			authors.push_back(QString::fromStdString(author));
+		}
+
+		row.cells[Columns::Id]        = QVariant(document.Id());
+		row.cells[Columns::Title]     = QString::fromStdString(document.Title());
+		row.cells[Columns::Authors]   = authors.join(", ");
+		row.cells[Columns::Published] = QDateTime::fromTime_t(document.Published()).date().toString(Qt::DateFormat::DefaultLocaleShortDate);
+		row.rendered = true;
+	}
+
+private:
+	std::vector<Row> rows;
+
+	const Database::MetadataColumns *columns;
+};
+
 #endif
\ No newline at end of file
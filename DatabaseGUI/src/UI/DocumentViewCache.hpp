@@ -0,0 +1,177 @@
+#ifndef DOCUMENT_VIEW_CACHE_H
+#define DOCUMENT_VIEW_CACHE_H
+
+#include <list>
+#include <string>
+#include <utility>
+
+#include <QObject>
+#include <QTimer>
+#include <QFont>
+#include <QString>
+#include <QTextDocument>
+#include <QTextCursor>
+#include <QTextCharFormat>
+#include <QTextBlockFormat>
+
+#include "Database/Document.hpp"
+
+/**
+ * The DocumentViewCache prepares the QTextDocument shown for a selected
+ * document, keeping the most recently used so that returning to a
+ * document doesn't render it again. Documents are identified by their
+ * id and version (see Database::Repository::Version), so a changed
+ * document is rendered afresh.
+ *
+ * Large bodies are rendered progressively: the title and the first
+ * chunk of the body are there straight away, and the rest is appended
+ * a chunk at a time between events, so the window stays responsive.
+ * Each chunk is converted from UTF-8 as it's rendered, so the cost of
+ * opening a document doesn't grow with its body.
+ */
+class DocumentViewCache : public QObject
+{
+	Q_OBJECT
+
+	// Bytes of a body rendered at a time
+	enum { ChunkSize = 32 * 1024 };
+
+	struct Entry {
+		unsigned int   id;
+		unsigned int   version;
+		QTextDocument *document;
+		std::string    remaining; // Body still to be rendered, as UTF-8
+		size_t         rendered;  // Bytes of it rendered so far
+	};
+
+public:
+	DocumentViewCache(const QFont &font, size_t capacity, QObject *parent = 0) : QObject(parent), font(font), capacity(capacity < 1 ? 1 : capacity)
+	{
+		timer = new QTimer(this);
+		timer->setSingleShot(true);
+		timer->setInterval(0);
+		connect(timer, SIGNAL(timeout()), this, SLOT(RenderChunk()));
+	}
+
+	/**
+	 * Get returns the view of a document at a version, rendering it if it
+	 * isn't cached. The view remains owned by the cache, and is valid
+	 * until it has been passed over by as many other documents as the
+	 * cache holds.
+	 */
+	QTextDocument *Get(const Database::Document &doc, unsigned int version)
+	{
+		// There are only a few entries, so they're searched in order of use
+		for (auto it = entries.begin(); it != entries.end(); ++it) {
+			if (it->id == doc.Id() && it->version == version) {
+				entries.splice(entries.begin(), entries, it);
+				return entries.front().document;
+			}
+		}
+
+		// Make room, dropping the least recently used
+		while (entries.size() >= capacity) {
+			delete entries.back().document;
+			entries.pop_back();
+		}
+
+		Entry entry = { doc.Id(), version, new QTextDocument(this), doc.Body(), 0 };
+		entry.document->setDefaultFont(font);
+		entry.document->setUndoRedoEnabled(false);
+
+		// Title, as a heading
+		QTextCursor cursor(entry.document);
+		QTextCharFormat heading;
+		heading.setFontPointSize(font.pointSizeF() * 2);
+		heading.setFontWeight(QFont::Bold);
+		cursor.insertText(QString::fromStdString(doc.Title()), heading);
+
+		// Body, in a fixed width font
+		QTextCharFormat body;
+		body.setFontFamily("Courier");
+		cursor.insertBlock(QTextBlockFormat(), body);
+
+		entries.push_front(std::move(entry));
+		renderChunk(entries.front());
+
+		return entries.front().document;
+	}
+
+	/**
+	 * Return whether a view has been completely rendered
+	 */
+	bool IsComplete(const QTextDocument *document) const
+	{
+		for (auto &entry : entries) {
+			if (entry.document == document) {
+				return entry.rendered == entry.remaining.size();
+			}
+		}
+		return true;
+	}
+
+	/**
+	 * Return the number of cached views
+	 */
+	size_t Size() const
+	{
+		return entries.size();
+	}
+
+private slots:
+	void RenderChunk()
+	{
+		// The most recently used view is rendered first
+		for (auto &entry : entries) {
+			if (entry.rendered < entry.remaining.size()) {
+				renderChunk(entry);
+				return;
+			}
+		}
+	}
+
+private:
+	// Append the next chunk of a view's body, and schedule any more
+	void renderChunk(Entry &entry)
+	{
+		size_t length = qMin<size_t>(ChunkSize, entry.remaining.size() - entry.rendered);
+
+		// Don't split a character, ending before any continuation byte
+		while (length > 0 && entry.rendered + length < entry.remaining.size() &&
+		       (static_cast<unsigned char>(entry.remaining[entry.rendered + length]) & 0xc0) == 0x80) {
+			--length;
+		}
+		if (length == 0) {
+			// Not UTF-8, so split it anyway
+			length = qMin<size_t>(ChunkSize, entry.remaining.size() - entry.rendered);
+		}
+
+		if (length > 0) {
+			QTextCursor cursor(entry.document);
+			cursor.movePosition(QTextCursor::End);
+			cursor.insertText(QString::fromUtf8(entry.remaining.data() + entry.rendered, static_cast<int>(length)));
+			entry.rendered += length;
+		}
+
+		if (entry.rendered == entry.remaining.size()) {
+			std::string().swap(entry.remaining);
+			entry.rendered = 0;
+		}
+
+		for (auto &other : entries) {
+			if (other.rendered < other.remaining.size()) {
+				timer->start();
+				break;
+			}
+		}
+	}
+
+private:
+	QFont  font;
+	size_t capacity;
+	QTimer *timer;
+
+	std::list<Entry> entries; // Most recently used first
+};
+
+#endif
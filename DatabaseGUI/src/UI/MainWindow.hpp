@@ -1,215 +1,665 @@
-#ifndef MAINWINDOW_H
-#define MAINWINDOW_H
-
-#include <QtWidgets/QMainWindow>
-#include <QtWidgets/QHeaderView>
-#include <QtWidgets/QGridLayout>
-#include <QtWidgets/QSplitter>
-#include <QtWidgets/QToolBar>
-#include <QtWidgets/QToolButton>
-#include <QtWidgets/QTableView>
-
-#include "DocumentDialog.hpp"
-#include "DocumentTableModel.hpp"
-
-#include "Database/ResearchDocumentRepository.hpp"
-
-/**
- * MainWindow is the applications main window, containing
- * a table with database results and an Add, Delete and Edit
- * button to manipulate database contents
- */
-class MainWindow : public QMainWindow
-{
-   Q_OBJECT
-
-public:
-    MainWindow(Database::ResearchDocumentRepository &dr, QWidget *parent = 0) : QMainWindow(parent), dr(dr), tableModel(nullptr), counter(8)
-	{
-		// Set basic window properties
-		setWindowTitle("Database Frontend");
-		setContextMenuPolicy(Qt::ContextMenuPolicy::NoContextMenu);
-		resize(600, 600);
-
-		// Toolbar add button
-		toolButtonAdd = new QToolButton(this);
-		toolButtonAdd->setText("Add");
-
-		// Toolbar delete button
-		toolButtonDel = new QToolButton(this);
-		toolButtonDel->setText("Delete");
-		toolButtonDel->setEnabled(false);
-
-		// Toolbar edit button
-		toolButtonEdit = new QToolButton(this);
-		toolButtonEdit->setText("Edit");
-		toolButtonEdit->setEnabled(false);
-
-		// Create toolbar and add buttons
-		toolbar = new QToolBar(this);
-		toolbar->setFloatable(false);
-		toolbar->setMovable(false);
-		toolbar->addWidget(toolButtonAdd);
-		toolbar->addWidget(toolButtonDel);
-		toolbar->addWidget(toolButtonEdit);
-		addToolBar(Qt::TopToolBarArea, toolbar);
-
-		// Create table
-		table = new QTableView(this);
-		table->setSelectionMode(QAbstractItemView::SelectionMode::SingleSelection);
-		table->setSelectionBehavior(QAbstractItemView::SelectRows);
-		table->verticalHeader()->setVisible(false);
-		table->horizontalHeader()->setStretchLastSection(true);
-		table->setSortingEnabled(true);
-		table->setAlternatingRowColors(true);
-		table->sortByColumn(0, Qt::SortOrder::AscendingOrder);
-
-		// Create text view
-		text = new QTextEdit(this);
-		text->setReadOnly(true);
-
-		// Create split view
-		splitter = new QSplitter(this);
-		splitter->addWidget(table);
-		splitter->addWidget(text);
-
-		// Create central widget
-		setCentralWidget(new QWidget(this));
-
-		// Create layout, adding table and text view
-		layout = new QGridLayout(centralWidget());
-		layout->setContentsMargins(0, 0, 0, 0);
-		layout->addWidget(splitter);
-
-		// Connect button clicks
-		connect(toolButtonAdd, SIGNAL(clicked()), this, SLOT(HandleAddButton()));
-		connect(toolButtonDel, SIGNAL(clicked()), this, SLOT(HandleDelButton()));
-		connect(toolButtonEdit, SIGNAL(clicked()), this, SLOT(HandleEditButton()));
-
-		// Name objects
-		toolButtonDel->setObjectName("del_button");
-		table->setObjectName("table");
-		text->setObjectName("text");
-
-		// Load table model
-		Load();
-
-		// Resize columns for initial load
-		table->resizeColumnsToContents();
-
-		// Select first row
-		table->setFocus();
-		table->selectRow(0);
-	}
-
-private:
-	void Load()
-	{
-		// Delete pointer to older tableModel if it exists
-		if (tableModel != nullptr)
-			delete tableModel;
-
-		// Create new document table model
-		tableModel = new DocumentTableModel(dr.FindAll(), this);
-		table->setModel(tableModel);
-
-		// Sort based upon table settings
-		table->sortByColumn(table->horizontalHeader()->sortIndicatorSection(), table->horizontalHeader()->sortIndicatorOrder());
-
-		// Connect selection changes
-		connect(table->selectionModel(), SIGNAL(currentChanged(const QModelIndex&, const QModelIndex&)), this, SLOT(HandleSelectionChange(const QModelIndex&, const QModelIndex&)));
-	}
-
-private slots:
-	void HandleAddButton()
-	{
-		// Create a document with placeholder values. Increment id counter.
-		Database::Document doc(counter++, "New Author", "", "");
-
-		// Display document dialog. If accepted, add new document and reload data.
-		DocumentDialog dialog(doc, this);
-		if (dialog.exec() == QDialog::Accepted) {
-			dr.Add(doc);
-			Load();
-		}
-	}
-
-	void HandleDelButton()
-	{
-		auto selected = table->selectionModel()->selectedRows();
-		if (selected.size() > 0) {
-			// If a row is selected, delete it.
-			dr.Remove(tableModel->Document(selected.at(0)));
-
-			// Disable delete & edit button
-			toolButtonDel->setDisabled(true);
-			toolButtonEdit->setDisabled(true);
-
-			// Clear text from view
-			text->clear();
-
-			// Reload data
-			Load();
-		}
-	}
-
-	void HandleEditButton()
-	{
-		auto selected = table->selectionModel()->selectedRows();
-		if (selected.size() > 0) {
-			// Get selected document
-			auto doc = tableModel->Document(selected.at(0));
-
-			// Remove the document
-			dr.Remove(doc);
-
-			// Create dialog, populated with document
-			DocumentDialog dialog(doc, this);
-			if (dialog.exec() == QDialog::Accepted) {
-				// Re-add the document with changes
-				dr.Add(doc);
-
-				// Reload data
-				Load();
-
-				// Reselect item
-				table->selectionModel()->setCurrentIndex(tableModel->index(selected.at(0).row(), 0), QItemSelectionModel::Select | QItemSelectionModel::Rows);
-			}
-		}
-	}
-
-	void HandleSelectionChange(const QModelIndex& current, const QModelIndex& previous)
-	{
-		if (current.row() >= 0) {
-			// A row has been selected, so enable delete & edit button
-			toolButtonDel->setDisabled(false);
-			toolButtonEdit->setDisabled(false);
-
-			// Update current text view to selected document
-			auto doc = tableModel->Document(current);
-			text->setHtml(QString("<h1>%1</h1><pre>%3</pre>").arg(QString::fromStdString(doc.Title())).arg(QString::fromStdString(doc.Body())));
-		} else {
-			// No row selected, disable delete & edit button
-			toolButtonDel->setDisabled(true);
-			toolButtonEdit->setDisabled(true);
-		}
-	}
-
-private:
-	int counter;
-	Database::ResearchDocumentRepository &dr;
-
-	QGridLayout *layout;
-	QSplitter   *splitter;
-
-	QToolBar    *toolbar;
-	QToolButton *toolButtonAdd;
-	QToolButton *toolButtonDel;
-	QToolButton *toolButtonEdit;
-	QTableView  *table;
-	QTextEdit   *text;
-
-	DocumentTableModel *tableModel;
-};
-
+#ifndef MAINWINDOW_H
+#define MAINWINDOW_H
+
+#include <QtWidgets/QMainWindow>
+#include <QtWidgets/QHeaderView>
+#include <QtWidgets/QGridLayout>
+#include <QtWidgets/QSplitter>
+#include <QtWidgets/QToolBar>
+#include <QtWidgets/QToolButton>
+#include <QtWidgets/QTableView>
+#include <QtWidgets/QLineEdit>
+#include <QtWidgets/QTreeWidget>
+#include <QtWidgets/QFileDialog>
+#include <QtWidgets/QStatusBar>
+#include <QtWidgets/QShortcut>
+#include <QtCore/QTimer>
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <fstream>
+#include <future>
+#include <chrono>
+#include <atomic>
+
+#include "DocumentDialog.hpp"
+#include "DocumentTableModel.hpp"
+#include "DocumentViewCache.hpp"
+
+#include "Database/ResearchDocumentRepository.hpp"
+#include "Database/RepositoryHistory.hpp"
+#include "Database/Replication.hpp"
+#include "Database/ThreadPool.hpp"
+#include "Database/DirectoryImporter.hpp"
+#include "Database/Workload.hpp"
+
+/**
+ * MainWindow is the applications main window, containing
+ * a table with database results and an Add, Delete and Edit
+ * button to manipulate database contents, along with Undo
+ * and Redo buttons to revert those changes.
+ *
+ * The filter bar above the table narrows it to documents whose title
+ * and authors have words starting with those typed. Searches run on a
+ * worker thread once typing pauses, and a search overtaken by further
+ * typing is cancelled.
+ *
+ * A sidebar counts the documents shown by author and by year.
+ *
+ * A directory of files can be imported, a document per file, with
+ * progress shown in the status bar as the files are read.
+ *
+ * While tracing is enabled (see Database::Trace), each action is timed,
+ * and Ctrl+Shift+T saves the trace for viewing in a trace viewer.
+ *
+ * While recording a workload (see Record), the searches made are
+ * recorded along with the changes.
+ *
+ * When following another process's change feed, the window is
+ * read-only and shows the changes as they are replicated.
+ */
+class MainWindow : public QMainWindow
+{
+   Q_OBJECT
+
+public:
+    MainWindow(Database::ResearchDocumentRepository &dr, QWidget *parent = 0) : QMainWindow(parent), dr(dr), history(dr), tableModel(nullptr), follower(nullptr), recorder(nullptr), facetsFiltered(false), filterGeneration(0), filterPool(1)
+	{
+		// Set basic window properties
+		setWindowTitle("Database Frontend");
+		setContextMenuPolicy(Qt::ContextMenuPolicy::NoContextMenu);
+		resize(600, 600);
+
+		// Toolbar add button
+		toolButtonAdd = new QToolButton(this);
+		toolButtonAdd->setText("Add");
+
+		// Toolbar delete button
+		toolButtonDel = new QToolButton(this);
+		toolButtonDel->setText("Delete");
+		toolButtonDel->setEnabled(false);
+
+		// Toolbar edit button
+		toolButtonEdit = new QToolButton(this);
+		toolButtonEdit->setText("Edit");
+		toolButtonEdit->setEnabled(false);
+
+		// Toolbar undo button
+		toolButtonUndo = new QToolButton(this);
+		toolButtonUndo->setText("Undo");
+		toolButtonUndo->setShortcut(QKeySequence::Undo);
+
+		// Toolbar redo button
+		toolButtonRedo = new QToolButton(this);
+		toolButtonRedo->setText("Redo");
+		toolButtonRedo->setShortcut(QKeySequence::Redo);
+
+		// Toolbar import button
+		toolButtonImport = new QToolButton(this);
+		toolButtonImport->setText("Import...");
+
+		// Create toolbar and add buttons
+		toolbar = new QToolBar(this);
+		toolbar->setFloatable(false);
+		toolbar->setMovable(false);
+		toolbar->addWidget(toolButtonAdd);
+		toolbar->addWidget(toolButtonDel);
+		toolbar->addWidget(toolButtonEdit);
+		toolbar->addSeparator();
+		toolbar->addWidget(toolButtonUndo);
+		toolbar->addWidget(toolButtonRedo);
+		toolbar->addSeparator();
+		toolbar->addWidget(toolButtonImport);
+		addToolBar(Qt::TopToolBarArea, toolbar);
+
+		// Create table
+		table = new QTableView(this);
+		table->setSelectionMode(QAbstractItemView::SelectionMode::SingleSelection);
+		table->setSelectionBehavior(QAbstractItemView::SelectRows);
+		table->verticalHeader()->setVisible(false);
+		table->horizontalHeader()->setStretchLastSection(true);
+		table->setSortingEnabled(true);
+		table->setAlternatingRowColors(true);
+		table->sortByColumn(0, Qt::SortOrder::AscendingOrder);
+
+		// Create text view, showing documents prepared by the view cache
+		text = new QTextEdit(this);
+		text->setReadOnly(true);
+		blank = new QTextDocument(this);
+		viewCache = new DocumentViewCache(text->font(), 16, this);
+		text->setDocument(blank);
+
+		// Create filter bar, searching once typing pauses
+		filter = new QLineEdit(this);
+		filter->setPlaceholderText("Filter by title or author");
+		filter->setClearButtonEnabled(true);
+
+		filterTimer = new QTimer(this);
+		filterTimer->setSingleShot(true);
+		filterTimer->setInterval(150);
+
+		// Create facet sidebar
+		facets = new QTreeWidget(this);
+		facets->setColumnCount(2);
+		facets->setHeaderHidden(true);
+		facets->setRootIsDecorated(false);
+
+		// Create split view
+		splitter = new QSplitter(this);
+		splitter->addWidget(facets);
+		splitter->addWidget(table);
+		splitter->addWidget(text);
+
+		// Create central widget
+		setCentralWidget(new QWidget(this));
+
+		// Create layout, adding table and text view
+		layout = new QGridLayout(centralWidget());
+		layout->setContentsMargins(0, 0, 0, 0);
+		layout->addWidget(filter, 0, 0);
+		layout->addWidget(splitter, 1, 0);
+
+		// Connect button clicks
+		connect(toolButtonAdd, SIGNAL(clicked()), this, SLOT(HandleAddButton()));
+		connect(toolButtonDel, SIGNAL(clicked()), this, SLOT(HandleDelButton()));
+		connect(toolButtonEdit, SIGNAL(clicked()), this, SLOT(HandleEditButton()));
+		connect(toolButtonUndo, SIGNAL(clicked()), this, SLOT(HandleUndoButton()));
+		connect(toolButtonRedo, SIGNAL(clicked()), this, SLOT(HandleRedoButton()));
+		connect(toolButtonImport, SIGNAL(clicked()), this, SLOT(HandleImportButton()));
+
+		// Save the trace on request
+		connect(new QShortcut(QKeySequence("Ctrl+Shift+T"), this), SIGNAL(activated()), this, SLOT(HandleTraceShortcut()));
+
+		// Imported documents are added a batch at a time between events
+		importTimer = new QTimer(this);
+		importTimer->setInterval(20);
+		connect(importTimer, SIGNAL(timeout()), this, SLOT(HandleImportTimer()));
+
+		// Connect filter changes
+		connect(filter, SIGNAL(textChanged(const QString&)), filterTimer, SLOT(start()));
+		connect(filterTimer, SIGNAL(timeout()), this, SLOT(HandleFilterTimer()));
+
+		// Name objects
+		toolButtonDel->setObjectName("del_button");
+		toolButtonUndo->setObjectName("undo_button");
+		toolButtonRedo->setObjectName("redo_button");
+		table->setObjectName("table");
+		filter->setObjectName("filter");
+		facets->setObjectName("facets");
+		text->setObjectName("text");
+
+		// Load table model
+		Load();
+
+		// Resize columns for initial load
+		table->resizeColumnsToContents();
+
+		// Select first row
+		table->setFocus();
+		table->selectRow(0);
+	}
+
+	~MainWindow()
+	{
+		// Don't leave a search running against the window
+		CancelFilter();
+	}
+
+	/**
+	 * Record adds the window's searches to a workload being recorded,
+	 * which records the changes itself
+	 */
+	void Record(Database::WorkloadRecorder &recorder)
+	{
+		this->recorder = &recorder;
+	}
+
+	/**
+	 * Follow applies a change feed to the repository as it is written,
+	 * showing the changes and how far behind the window is. Editing is
+	 * disabled, as the repository is a copy.
+	 */
+	void Follow(Database::ReplicationFollower &follower)
+	{
+		this->follower = &follower;
+		toolbar->setVisible(false);
+
+		followTimer = new QTimer(this);
+		connect(followTimer, SIGNAL(timeout()), this, SLOT(HandleFollowTimer()));
+		followTimer->start(250);
+
+		HandleFollowTimer();
+	}
+
+private:
+	void Load()
+	{
+		Database::TraceSpan span("MainWindow::Load");
+
+		// Create new document table model, of the documents passing the
+		// filter. Filtering may wait for the indexes, so it's done on the
+		// worker; until it's done, the documents matched last time that
+		// are still there are shown, as some may have been removed.
+		std::string query = filter->text().trimmed().toStdString();
+		if (query.empty()) {
+			SetModel(new DocumentTableModel(dr.FindAll(), this));
+
+			facetsFiltered = false;
+			ShowFacets();
+		} else {
+			std::vector<const Database::Document*> previous;
+			for (auto &document : dr.FindAll()) {
+				if (facetsWithin.Contains(document.Id())) {
+					previous.push_back(&document);
+				}
+			}
+			SetModel(new DocumentTableModel(previous, this));
+
+			HandleFilterTimer();
+		}
+
+		// Enable undo & redo buttons if there are changes to revert
+		toolButtonUndo->setEnabled(history.CanUndo());
+		toolButtonRedo->setEnabled(history.CanRedo());
+	}
+
+	void SetModel(DocumentTableModel *model)
+	{
+		// Delete pointer to older tableModel if it exists
+		if (tableModel != nullptr)
+			delete tableModel;
+
+		tableModel = model;
+		table->setModel(tableModel);
+
+		// Sort by the metadata columns once they're built
+		if (dr.IndexesReady()) {
+			tableModel->SortWith(&dr.Columns());
+		}
+
+		// Sort based upon table settings
+		table->sortByColumn(table->horizontalHeader()->sortIndicatorSection(), table->horizontalHeader()->sortIndicatorOrder());
+
+		// Connect selection changes
+		connect(table->selectionModel(), SIGNAL(currentChanged(const QModelIndex&, const QModelIndex&)), this, SLOT(HandleSelectionChange(const QModelIndex&, const QModelIndex&)));
+	}
+
+	void ShowMatching(const std::vector<const Database::Document*> &matching)
+	{
+		SetModel(new DocumentTableModel(matching, this));
+
+		// Count only the matching documents in the sidebar
+		facetsWithin = Database::IdSet();
+		for (auto document : matching) {
+			facetsWithin.Insert(document->Id());
+		}
+		facetsFiltered = true;
+		ShowFacets();
+	}
+
+	/**
+	 * CancelFilter cancels every search in progress, and waits for them
+	 * to stop reading the repository so that the repository can be changed
+	 */
+	void CancelFilter()
+	{
+		Database::TraceSpan span("MainWindow::CancelFilter");
+
+		++filterGeneration;
+		for (auto &search : filtering) {
+			search.second.wait();
+		}
+		filtering.clear();
+	}
+
+	/**
+	 * ForgetHistory forgets the changes that could be undone or redone,
+	 * once the repository has been changed other than through the history
+	 */
+	void ForgetHistory()
+	{
+		history.Clear();
+		toolButtonUndo->setEnabled(false);
+		toolButtonRedo->setEnabled(false);
+	}
+
+	void ClearSelection()
+	{
+		// Disable delete & edit button
+		toolButtonDel->setDisabled(true);
+		toolButtonEdit->setDisabled(true);
+
+		// Clear text from view, leaving cached views as they are
+		text->setDocument(blank);
+	}
+
+private slots:
+	void HandleAddButton()
+	{
+		Database::TraceSpan span("MainWindow::HandleAddButton");
+
+		// Create a document with placeholder values, under a new id from the repository.
+		Database::Document doc(dr.NextId(), "New Author", "", "");
+
+		// Display document dialog. If accepted, add new document and reload data.
+		DocumentDialog dialog(doc, this);
+		if (dialog.exec() == QDialog::Accepted) {
+			CancelFilter();
+			history.Add(std::move(doc));
+			Load();
+		}
+	}
+
+	void HandleDelButton()
+	{
+		Database::TraceSpan span("MainWindow::HandleDelButton");
+
+		auto selected = table->selectionModel()->selectedRows();
+		if (selected.size() > 0) {
+			// If a row is selected, delete it.
+			CancelFilter();
+			history.Remove(tableModel->Document(selected.at(0)).Id());
+
+			ClearSelection();
+
+			// Reload data
+			Load();
+		}
+	}
+
+	void HandleEditButton()
+	{
+		Database::TraceSpan span("MainWindow::HandleEditButton");
+
+		auto selected = table->selectionModel()->selectedRows();
+		if (selected.size() > 0) {
+			// Get a copy of the selected document to edit
+			auto doc = tableModel->Document(selected.at(0));
+
+			// Create dialog, populated with document
+			DocumentDialog dialog(doc, this);
+			if (dialog.exec() == QDialog::Accepted) {
+				// Apply the changes to the stored document
+				CancelFilter();
+				history.Update(doc.Id(), [&](Database::Document &stored) {
+					stored = std::move(doc);
+				});
+
+				// Reload data
+				Load();
+
+				// Reselect item
+				table->selectionModel()->setCurrentIndex(tableModel->index(selected.at(0).row(), 0), QItemSelectionModel::Select | QItemSelectionModel::Rows);
+			}
+		}
+	}
+
+	void HandleUndoButton()
+	{
+		Database::TraceSpan span("MainWindow::HandleUndoButton");
+
+		CancelFilter();
+		if (history.Undo()) {
+			ClearSelection();
+			Load();
+		}
+	}
+
+	void HandleRedoButton()
+	{
+		Database::TraceSpan span("MainWindow::HandleRedoButton");
+
+		CancelFilter();
+		if (history.Redo()) {
+			ClearSelection();
+			Load();
+		}
+	}
+
+	void HandleImportButton()
+	{
+		Database::TraceSpan span("MainWindow::HandleImportButton");
+
+		QString directory = QFileDialog::getExistingDirectory(this, "Import Directory");
+		if (directory.isEmpty() || importer) {
+			return;
+		}
+
+		// Files are read in the background, while the window remains usable.
+		// The importer adds documents behind the history's back, possibly
+		// under the ids of removed documents, so the history is forgotten.
+		ForgetHistory();
+		importer.reset(new Database::DirectoryImporter(dr));
+		if (!importer->Start(directory.toStdString())) {
+			importer.reset();
+			statusBar()->showMessage("Couldn't read directory", 5000);
+			return;
+		}
+
+		toolButtonImport->setEnabled(false);
+		importTimer->start();
+	}
+
+	void HandleImportTimer()
+	{
+		Database::TraceSpan span("MainWindow::HandleImportTimer");
+
+		// Searches are only cancelled when there are documents to add,
+		// which are added for only part of each tick to keep the window
+		// responsive, and then searched again
+		if (importer->Ready()) {
+			CancelFilter();
+			if (importer->StepFor(std::chrono::milliseconds(10)) > 0) {
+				ForgetHistory();
+			}
+			if (!filter->text().trimmed().isEmpty()) {
+				HandleFilterTimer();
+			}
+		}
+
+		auto progress = importer->Progress();
+		if (!importer->Finished()) {
+			statusBar()->showMessage(QString("Importing: %1 of %2 files added").arg(progress.added).arg(progress.files));
+			return;
+		}
+
+		// Show the imported documents
+		importTimer->stop();
+		importer.reset();
+		toolButtonImport->setEnabled(true);
+		statusBar()->showMessage(QString("Imported %1 documents, %2 failed").arg(progress.added).arg(progress.failed), 5000);
+
+		ClearSelection();
+		Load();
+	}
+
+	void HandleTraceShortcut()
+	{
+		if (!Database::Trace::Enabled()) {
+			statusBar()->showMessage("Tracing is off, start with --trace <file> to enable it", 5000);
+			return;
+		}
+
+		QString path = QFileDialog::getSaveFileName(this, "Save Trace", "trace.json", "Chrome Trace (*.json)");
+		if (!path.isEmpty()) {
+			std::ofstream file(path.toStdString());
+			Database::Trace::Export(file);
+		}
+	}
+
+	void HandleFollowTimer()
+	{
+		Database::TraceSpan span("MainWindow::HandleFollowTimer");
+
+		// Searches are only cancelled when there are changes to apply
+		if (follower->Pending()) {
+			CancelFilter();
+			if (follower->Poll() > 0) {
+				ForgetHistory();
+				ClearSelection();
+			}
+			Load();
+		}
+
+		// Report replication progress
+		auto progress = follower->Progress();
+		if (progress.failed) {
+			setWindowTitle(QString("Database Frontend (replication stopped at change %1)").arg(progress.applied));
+			followTimer->stop();
+		} else {
+			setWindowTitle(QString("Database Frontend (following: change %1, %2 ms behind)").arg(progress.applied).arg(progress.lag.count()));
+		}
+	}
+
+	void HandleFilterTimer()
+	{
+		Database::TraceSpan span("MainWindow::HandleFilterTimer");
+
+		// Overtake any search still running
+		unsigned int generation = ++filterGeneration;
+		std::string query = filter->text().trimmed().toStdString();
+		if (query.empty()) {
+			Load();
+			return;
+		}
+
+		if (recorder != nullptr) {
+			recorder->Find(Database::WorkloadOperation::FindMatching, query);
+		}
+
+		// Forget overtaken searches that have finished
+		for (auto it = filtering.begin(); it != filtering.end();) {
+			if (it->second.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+				it = filtering.erase(it);
+			} else {
+				++it;
+			}
+		}
+
+		// Search on the worker, which returns the results through its
+		// future, and has them shown unless it's been overtaken by then
+		filtering[generation] = filterPool.Submit([this, query, generation] {
+			auto stale = [this, generation] { return filterGeneration != generation; };
+			auto matching = dr.FindMatching(query, stale);
+			if (!stale()) {
+				QMetaObject::invokeMethod(this, "HandleFilterResults", Qt::QueuedConnection, Q_ARG(unsigned int, generation));
+			}
+			return matching;
+		});
+	}
+
+	void HandleFilterResults(unsigned int generation)
+	{
+		Database::TraceSpan span("MainWindow::HandleFilterResults");
+
+		auto search = filtering.find(generation);
+		if (generation != filterGeneration || search == filtering.end()) {
+			return;
+		}
+		auto matching = search->second.get();
+		filtering.erase(search);
+
+		ShowMatching(matching);
+	}
+
+	void ShowFacets()
+	{
+		Database::TraceSpan span("MainWindow::ShowFacets");
+
+		// Counts come from the indexes, so wait for them to be built
+		// rather than holding up the window
+		if (!dr.IndexesReady()) {
+			QTimer::singleShot(100, this, SLOT(ShowFacets()));
+			return;
+		}
+
+		if (recorder != nullptr) {
+			recorder->Facets(facetsFiltered);
+		}
+
+		// Only the most prolific authors are listed
+		auto authors = facetsFiltered ? dr.MostProlificAuthors(10, facetsWithin) : dr.MostProlificAuthors(10);
+		auto years   = facetsFiltered ? dr.CountByYear(facetsWithin) : dr.CountByYear();
+
+		facets->clear();
+		auto authorItems = new QTreeWidgetItem(facets, QStringList("Authors"));
+		for (auto &author : authors) {
+			new QTreeWidgetItem(authorItems, QStringList() << QString::fromStdString(author.first) << QString::number(author.second));
+		}
+		auto yearItems = new QTreeWidgetItem(facets, QStringList("Years"));
+		for (auto &year : years) {
+			new QTreeWidgetItem(yearItems, QStringList() << QString::number(year.first) << QString::number(year.second));
+		}
+		facets->expandAll();
+		facets->resizeColumnToContents(0);
+	}
+
+	void HandleSelectionChange(const QModelIndex& current, const QModelIndex& previous)
+	{
+		Database::TraceSpan span("MainWindow::HandleSelectionChange");
+
+		if (current.row() >= 0) {
+			// A row has been selected, so enable delete & edit button
+			toolButtonDel->setDisabled(false);
+			toolButtonEdit->setDisabled(false);
+
+			// Update current text view to selected document, which is
+			// rendered only if it isn't cached
+			auto &doc = tableModel->Document(current);
+			text->setDocument(viewCache->Get(doc, dr.Version(doc.Id())));
+		} else {
+			// No row selected, disable delete & edit button
+			toolButtonDel->setDisabled(true);
+			toolButtonEdit->setDisabled(true);
+		}
+	}
+
+private:
+	Database::ResearchDocumentRepository &dr;
+	Database::RepositoryHistory history;
+
+	QGridLayout *layout;
+	QSplitter   *splitter;
+
+	QToolBar    *toolbar;
+	QToolButton *toolButtonAdd;
+	QToolButton *toolButtonDel;
+	QToolButton *toolButtonEdit;
+	QToolButton *toolButtonUndo;
+	QToolButton *toolButtonRedo;
+	QToolButton *toolButtonImport;
+	QTableView  *table;
+	QTextEdit   *text;
+
+	QTextDocument     *blank;
+	DocumentViewCache *viewCache;
+
+	DocumentTableModel *tableModel;
+
+	Database::ReplicationFollower *follower;
+	Database::WorkloadRecorder    *recorder;
+	QTimer                        *followTimer;
+
+	std::unique_ptr<Database::DirectoryImporter> importer;
+	QTimer                                       *importTimer;
+
+	QLineEdit *filter;
+	QTimer    *filterTimer;
+
+	// The sidebar counts only the documents within facetsWithin when filtered
+	QTreeWidget     *facets;
+	Database::IdSet facetsWithin;
+	bool            facetsFiltered;
+
+	// Searches run on a worker thread, each with a new generation. A
+	// search is stale, and is cancelled, once the generation moves on.
+	// An overtaken search may still be running after newer ones, so
+	// each is kept, by generation, until it has been waited for.
+	typedef std::vector<const Database::Document*> Matches;
+	std::atomic<unsigned int>                      filterGeneration;
+	std::map<unsigned int, std::future<Matches>>   filtering;
+	Database::ThreadPool                           filterPool;
+};
+
 #endif
\ No newline at end of file
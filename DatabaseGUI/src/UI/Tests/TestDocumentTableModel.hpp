@@ -0,0 +1,69 @@
+#ifndef TEST_DOCUMENT_TABLE_MODEL_H
+#define TEST_DOCUMENT_TABLE_MODEL_H
+
+#include <vector>
+
+#include <QTest>
+#include "UI/DocumentTableModel.hpp"
+#include "Database/ResearchDocumentRepository.hpp"
+
+/**
+ * Unit test for DocumentTableModel
+ */
+class TestDocumentTableModel: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testDocumentTableModel()
+	{
+		// Setup initial state for test
+		std::vector<Database::Document> documents;
+		documents.push_back(Database::Document(0, "Edwin Dusty", "B Title", "Document Text"));
+		documents.push_back(Database::Document(1, "Jarrod Otis", "A Title", "Document Text"));
+		documents.back().Authors().push_back("Harland Raymond");
+
+		DocumentTableModel model(documents, nullptr);
+
+		// Render the first row, then sort by title so the rows swap
+		QCOMPARE(model.data(model.index(0, 1)).toString(), QString("B Title"));
+		model.sort(1);
+
+		// Compare output with expected, rendered rows having moved with their documents
+		QCOMPARE(model.data(model.index(0, 0)).toUInt(), 1u);
+		QCOMPARE(model.data(model.index(0, 2)).toString(), QString("Jarrod Otis, Harland Raymond"));
+		QCOMPARE(model.data(model.index(1, 1)).toString(), QString("B Title"));
+		QCOMPARE(model.Document(model.index(1, 0)).Id(), 0u);
+	}
+
+    void testSortWithColumns()
+	{
+		Database::ResearchDocumentRepository dr;
+		dr.Add(Database::Document(0, "Edwin Dusty", "B Title", "Document Text", 300));
+		dr.Add(Database::Document(1, "Jarrod Otis", "A Title", "Document Text", 100));
+		dr.Add(Database::Document(2, "Edwin Dusty", "C Title", "Document Text", 200));
+		dr.Update(2, [](Database::Document &doc) { doc.Authors().push_back("Harland Raymond"); });
+
+		DocumentTableModel plain(dr.FindAll(), nullptr), columnar(dr.FindAll(), nullptr);
+		columnar.SortWith(&dr.Columns());
+
+		// Sorting by the columns gives the same order as by the documents
+		for (int column = 0; column < columnar.columnCount(); ++column) {
+			for (auto order : { Qt::AscendingOrder, Qt::DescendingOrder }) {
+				plain.sort(column, order);
+				columnar.sort(column, order);
+				for (int row = 0; row < columnar.rowCount(); ++row) {
+					QCOMPARE(columnar.Document(columnar.index(row, 0)).Id(), plain.Document(plain.index(row, 0)).Id());
+				}
+			}
+		}
+
+		columnar.sort(3, Qt::DescendingOrder);
+		QCOMPARE(columnar.data(columnar.index(0, 0)).toUInt(), 0u);
+		columnar.sort(2);
+		QCOMPARE(columnar.data(columnar.index(0, 2)).toString(), QString("Edwin Dusty"));
+		QCOMPARE(columnar.data(columnar.index(1, 2)).toString(), QString("Edwin Dusty, Harland Raymond"));
+	}
+};
+
+#endif
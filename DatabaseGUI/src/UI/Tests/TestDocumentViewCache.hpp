@@ -0,0 +1,51 @@
+#ifndef TEST_DOCUMENT_VIEW_CACHE_H
+#define TEST_DOCUMENT_VIEW_CACHE_H
+
+#include <QTest>
+#include "UI/DocumentViewCache.hpp"
+
+/**
+ * Unit test for DocumentViewCache
+ */
+class TestDocumentViewCache: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testDocumentViewCache()
+	{
+		// Setup initial state for test
+		DocumentViewCache cache(QFont(), 2);
+
+		Database::Document small(0, "Edwin Dusty", "A Title", "Document Text");
+		Database::Document large(1, "Jarrod Otis", "A Large Title", std::string(1000000, 'x'));
+
+		// Emulate selecting the same document twice, then a changed version
+		auto first = cache.Get(small, 1);
+		QCOMPARE(cache.Get(small, 1), first);
+		QCOMPARE(first->toPlainText(), QString("A Title\nDocument Text"));
+		QVERIFY(cache.Get(small, 2) != first);
+
+		// A large body shows its first chunk straight away, and the rest later
+		auto view = cache.Get(large, 1);
+		QVERIFY(!cache.IsComplete(view));
+		QVERIFY(view->characterCount() > 1000);
+		QTRY_VERIFY(cache.IsComplete(view));
+		QCOMPARE(view->toPlainText().size(), 1000000 + 14);
+
+		// Chunks don't split characters that take more than one byte
+		std::string euros;
+		for (int i = 0; i < 30000; ++i) {
+			euros += "\xe2\x82\xac";
+		}
+		Database::Document wide(2, "Harland Raymond", "Euros", euros);
+		auto wideView = cache.Get(wide, 1);
+		QTRY_VERIFY(cache.IsComplete(wideView));
+		QCOMPARE(wideView->toPlainText(), QString("Euros\n") + QString::fromStdString(euros));
+
+		// Only the two most recent views are kept
+		QCOMPARE(cache.Size(), size_t(2));
+	}
+};
+
+#endif
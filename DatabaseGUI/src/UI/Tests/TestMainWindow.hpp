@@ -1,54 +1,85 @@
-#ifndef TEST_MAIN_WINDOW_H
-#define TEST_MAIN_WINDOW_H
-
-#include <QTest>
-#include "UI/MainWindow.hpp"
-
-/**
- * Unit test for TestMainWindow
- */
-class TestMainWindow: public QObject
-{
-    Q_OBJECT
-
-private slots:
-    void testMainWindow()
-	{
-		// Setup initial state for test
-		Database::ResearchDocumentRepository dr;
-
-		Database::Document documents[] = {
-		  Database::Document(0, "Edwin Dusty",     "A Title",                "Document Text"),
-		  Database::Document(1, "Jarrod Otis",     "A Slightly Large Title", "Document Text"),
-		  Database::Document(2, "Harland Raymond", "A Non-Unique Title",     "Document Text"),
-		};
-	
-		for (auto &doc : documents) {
-			dr.Add(doc);
-		}
-
-		MainWindow mainWindow(dr);
-
-		// Wait for window to display
-		mainWindow.show();
-		QTest::qWaitForWindowActive(&mainWindow);
-
-		// Find controls
-		auto delButton = mainWindow.findChild<QToolButton*>("del_button");
-		auto table     = mainWindow.findChild<QTableView*>("table");
-		auto text      = mainWindow.findChild<QTextEdit*>("text");
-
-		// Emulate deleting first document, selecting second and deleting
-		// followed by selecting the third
-		QTest::mouseClick(delButton, Qt::MouseButton::LeftButton);
-		QTest::keyClick(table, Qt::Key::Key_Tab);
-		QTest::mouseClick(delButton, Qt::MouseButton::LeftButton);
-		QTest::keyClick(table, Qt::Key::Key_Tab);
-
-		// Compare output with expected
-		QCOMPARE(table->model()->rowCount(), 1);
-		QCOMPARE(text->toPlainText(), QString("A Non-Unique Title\nDocument Text"));
-	}
-};
-
+#ifndef TEST_MAIN_WINDOW_H
+#define TEST_MAIN_WINDOW_H
+
+#include <QTest>
+#include "UI/MainWindow.hpp"
+
+/**
+ * Unit test for TestMainWindow
+ */
+class TestMainWindow: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testMainWindow()
+	{
+		// Setup initial state for test
+		Database::ResearchDocumentRepository dr;
+
+		Database::Document documents[] = {
+		  Database::Document(0, "Edwin Dusty",     "A Title",                "Document Text"),
+		  Database::Document(1, "Jarrod Otis",     "A Slightly Large Title", "Document Text"),
+		  Database::Document(2, "Harland Raymond", "A Non-Unique Title",     "Document Text"),
+		};
+	
+		for (auto &doc : documents) {
+			dr.Add(doc);
+		}
+
+		MainWindow mainWindow(dr);
+
+		// Wait for window to display
+		mainWindow.show();
+		QTest::qWaitForWindowActive(&mainWindow);
+
+		// Find controls
+		auto delButton = mainWindow.findChild<QToolButton*>("del_button");
+		auto table     = mainWindow.findChild<QTableView*>("table");
+		auto text      = mainWindow.findChild<QTextEdit*>("text");
+
+		// Emulate deleting first document, selecting second and deleting
+		// followed by selecting the third
+		QTest::mouseClick(delButton, Qt::MouseButton::LeftButton);
+		QTest::keyClick(table, Qt::Key::Key_Tab);
+		QTest::mouseClick(delButton, Qt::MouseButton::LeftButton);
+		QTest::keyClick(table, Qt::Key::Key_Tab);
+
+		// Compare output with expected
+		QCOMPARE(table->model()->rowCount(), 1);
+		QCOMPARE(text->toPlainText(), QString("A Non-Unique Title\nDocument Text"));
+	}
+
+    void testFilter()
+	{
+		// Setup initial state for test
+		Database::ResearchDocumentRepository dr;
+		dr.Add(Database::Document(0, "Edwin Dusty",     "A Title",             "Document Text"));
+		dr.Add(Database::Document(1, "Jarrod Otis",     "A Title: The Sequel", "Document Text"));
+		dr.Add(Database::Document(2, "Harland Raymond", "A Non-Unique Title",  "Document Text"));
+
+		MainWindow mainWindow(dr);
+		mainWindow.show();
+		QTest::qWaitForWindowActive(&mainWindow);
+
+		// Find controls
+		auto filter = mainWindow.findChild<QLineEdit*>("filter");
+		auto table  = mainWindow.findChild<QTableView*>("table");
+
+		// Emulate typing a filter, which is applied once typing pauses
+		QTest::keyClicks(filter, "tit seq");
+		QTRY_COMPARE(table->model()->rowCount(), 1);
+		QCOMPARE(table->model()->index(0, 0).data().toUInt(), 1u);
+
+		// The sidebar counts only the documents shown
+		auto facets = mainWindow.findChild<QTreeWidget*>("facets");
+		QCOMPARE(facets->topLevelItem(0)->childCount(), 1);
+		QCOMPARE(facets->topLevelItem(0)->child(0)->text(0), QString("Jarrod Otis"));
+
+		// Clearing the filter shows every document again
+		filter->clear();
+		QTRY_COMPARE(table->model()->rowCount(), 3);
+	}
+};
+
 #endif
\ No newline at end of file
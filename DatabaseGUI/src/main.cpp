@@ -1,46 +1,159 @@
-#include <QApplication>
-#include <QDebug>
-
-#include "UI/MainWindow.hpp"
-#include "Database/ResearchDocumentRepository.hpp"
-
-void QtUnitTests(int, char *[]);
-void DatabaseTests();
-
-int main(int argc, char *argv[])
-{
-	Database::ResearchDocumentRepository dr;
-
-	// Setup default documents
-	Database::Document documents[] = {
-	  Database::Document(0, "Edwin Dusty",     "A Title",                "Document Text"),
-	  Database::Document(1, "Jarrod Otis",     "A Slightly Large Title", "Document Text"),
-	  Database::Document(2, "Harland Raymond", "A Non-Unique Title",     "Document Text"),
-	  Database::Document(3, "Eldred Wilson",   "A Non-Unique Title",     "Document Text"),
-	  Database::Document(4, "Andrew Bishop",   "A Non-Unique Title",     "Document Text"),
-	  Database::Document(5, "Andrew Bishop",   "A SHOUTY TITLE",         "Document Text"),
-	  Database::Document(6, "Harland Raymond", "A Title: The Sequel",    "Document Text"),
-	  Database::Document(7, "Jarrod Otis",     "A Title: The Prequel",   "Document Text")
-	};
-	
-	for (auto &doc : documents) {
-		dr.Add(doc);
-	}
-
-	// GUI
-    QApplication a(argc, argv);
-
-	// Testing
-#ifndef NDEBUG
-	QtUnitTests(argc, argv);
-	DatabaseTests();
-#endif
-
-	typedef QList<QMap<QString, QString>> Data;
-	auto dataList = static_cast<Data*>(nullptr);
-
-    MainWindow w(dr);
-    w.show();
-
-    return a.exec();
+#include <QApplication>
+#include <QDebug>
+
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include <cstring>
+
+#include "UI/MainWindow.hpp"
+#include "Database/ResearchDocumentRepository.hpp"
+#include "Database/Replication.hpp"
+#include "Database/Trace.hpp"
+#include "Database/Workload.hpp"
+#include "Database/DirectoryImporter.hpp"
+
+void QtUnitTests(int, char *[]);
+void DatabaseTests();
+
+int main(int argc, char *argv[])
+{
+	Database::ResearchDocumentRepository dr;
+
+	// Replication: "--feed <file>" writes changes to a file,
+	// "--follow <file>" shows a read-only copy of them.
+	// Tracing: "--trace <file>" writes a Chrome trace of the session.
+	// Workloads: "--record <file>" writes the session's operations to a
+	// file ("--record-anonymized <file>" without their content), and
+	// "--replay <file>" runs them again without a window, reporting how
+	// long they took.
+	const char *feedPath = nullptr, *followPath = nullptr, *tracePath = nullptr;
+	const char *recordPath = nullptr, *replayPath = nullptr;
+	bool anonymize = false;
+	for (int i = 1; i + 1 < argc; ++i) {
+		if (std::strcmp(argv[i], "--feed") == 0) {
+			feedPath = argv[++i];
+		} else if (std::strcmp(argv[i], "--follow") == 0) {
+			followPath = argv[++i];
+		} else if (std::strcmp(argv[i], "--trace") == 0) {
+			tracePath = argv[++i];
+		} else if (std::strcmp(argv[i], "--record") == 0 || std::strcmp(argv[i], "--record-anonymized") == 0) {
+			anonymize = std::strcmp(argv[i], "--record-anonymized") == 0;
+			recordPath = argv[++i];
+		} else if (std::strcmp(argv[i], "--replay") == 0) {
+			replayPath = argv[++i];
+		}
+	}
+
+	if (replayPath != nullptr) {
+		std::ifstream replayFile(replayPath, std::ios::binary);
+		Database::WorkloadReplay replay(dr);
+		if (!replay.Read(replayFile)) {
+			std::cerr << replayPath << " is not a recorded workload" << std::endl;
+			return 1;
+		}
+		if (!replay.Complete()) {
+			std::cerr << "The workload was cut short, replaying the " << replay.Size() << " whole operations" << std::endl;
+		}
+
+		replay.Run();
+		replay.Report(std::cout);
+		return 0;
+	}
+
+	// Setup default documents
+	Database::Document documents[] = {
+	  Database::Document(0, "Edwin Dusty",     "A Title",                "Document Text"),
+	  Database::Document(1, "Jarrod Otis",     "A Slightly Large Title", "Document Text"),
+	  Database::Document(2, "Harland Raymond", "A Non-Unique Title",     "Document Text"),
+	  Database::Document(3, "Eldred Wilson",   "A Non-Unique Title",     "Document Text"),
+	  Database::Document(4, "Andrew Bishop",   "A Non-Unique Title",     "Document Text"),
+	  Database::Document(5, "Andrew Bishop",   "A SHOUTY TITLE",         "Document Text"),
+	  Database::Document(6, "Harland Raymond", "A Title: The Sequel",    "Document Text"),
+	  Database::Document(7, "Jarrod Otis",     "A Title: The Prequel",   "Document Text")
+	};
+	
+	// The window polls the feed between events, so it must be a file,
+	// which reading doesn't block on as a pipe would
+	std::ifstream followFile;
+	if (followPath != nullptr) {
+		std::error_code error;
+		if (!Database::filesystem::is_regular_file(followPath, error)) {
+			std::cerr << followPath << " is not a change feed file" << std::endl;
+			return 1;
+		}
+
+		followFile.open(followPath, std::ios::binary);
+		if (!followFile) {
+			std::cerr << "Couldn't open " << followPath << std::endl;
+			return 1;
+		}
+	}
+
+	// Show the documents before their indexes are built. A follower
+	// receives its documents from the feed instead.
+	if (followPath == nullptr) {
+		dr.DeferIndexing();
+		for (auto &doc : documents) {
+			dr.Add(std::move(doc));
+		}
+		dr.BuildIndexesInBackground();
+	}
+
+	std::ofstream feedFile;
+	std::unique_ptr<Database::ChangeFeed> feed;
+	if (feedPath != nullptr) {
+		feedFile.open(feedPath, std::ios::binary | std::ios::trunc);
+		feed.reset(new Database::ChangeFeed(dr, feedFile));
+	}
+
+	std::ofstream recordFile;
+	std::unique_ptr<Database::WorkloadRecorder> recorder;
+	if (recordPath != nullptr) {
+		recordFile.open(recordPath, std::ios::binary | std::ios::trunc);
+		recorder.reset(new Database::WorkloadRecorder(dr, recordFile, anonymize));
+	}
+
+	// GUI
+    QApplication a(argc, argv);
+
+	// Testing
+#ifndef NDEBUG
+	// QTest rejects options it doesn't know, so leave out our own options
+	bool ownOptions = feedPath != nullptr || followPath != nullptr || tracePath != nullptr || recordPath != nullptr;
+	QtUnitTests(ownOptions ? 1 : argc, argv);
+	DatabaseTests();
+#endif
+
+	// Trace the session from here, leaving out the tests
+	if (tracePath != nullptr) {
+		Database::Trace::Clear();
+		Database::Trace::Enable();
+	}
+
+	typedef QList<QMap<QString, QString>> Data;
+	auto dataList = static_cast<Data*>(nullptr);
+
+    MainWindow w(dr);
+
+	std::unique_ptr<Database::ReplicationFollower> follower;
+	if (followPath != nullptr) {
+		follower.reset(new Database::ReplicationFollower(dr, followFile));
+		w.Follow(*follower);
+	}
+
+	if (recorder) {
+		w.Record(*recorder);
+	}
+
+    w.show();
+
+	int result = a.exec();
+
+	if (tracePath != nullptr) {
+		std::ofstream traceFile(tracePath);
+		Database::Trace::Export(traceFile);
+	}
+
+	return result;
 }
\ No newline at end of file
@@ -1,233 +1,1691 @@
-#include <iostream>
-#include <functional>
-
-#include <QDebug>
-
-#include "UI/Tests/TestAuthorWidget.hpp"
-#include "UI/Tests/TestDocumentDialog.hpp"
-#include "UI/Tests/TestMainWindow.hpp"
-
-#include "Database/ResearchDocumentRepository.hpp"
-
-/**
- * Run unit tests for the GUI application
- */
-void QtUnitTests(int argc, char *argv[])
-{
-	TestAuthorWidget test1;
-	QTest::qExec(&test1, argc, argv);
-
-	TestDocumentDialog test2;
-	QTest::qExec(&test2, argc, argv);
-
-	TestMainWindow test3;
-	QTest::qExec(&test3, argc, argv);
-}
-
-/**
- * Run database tests
- */
-void DatabaseTests()
-{
-	// Store name of test and lambda function to be called
-	// when executing the text.
-	struct {
-		std::string name;
-		std::function<bool()> func;
-	} tests[] = {
-		// Positive tests
-		{ 
-			"Positive Test: Adding document to database",
-			[&] {
-				Database::ResearchDocumentRepository dr;
-				Database::Document doc(0, "a", "b", "c");
-				return dr.Add(doc) &&
-				       dr.FindOneById(0) != nullptr &&
-				       dr.FindAll().size() == 1;
-			}
-		},
-		{ 
-			"Positive Test: Adding multiple documents to database",
-			[&] {
-				Database::ResearchDocumentRepository dr;
-				Database::Document doc1(0, "a", "b", "c");
-				Database::Document doc2(1, "a", "b", "c");
-				return dr.Add(doc1) &&
-				       dr.Add(doc2) &&
-				       dr.FindOneById(0) != nullptr &&
-					   dr.FindOneById(1) != nullptr &&
-				       dr.FindAll().size() == 2;
-			}
-		},
-		{
-			"Positive Test: Deleting document from database",
-			[&] {
-				Database::ResearchDocumentRepository dr;
-				Database::Document doc(0, "a", "b", "c");
-				return dr.Add(doc) &&
-				       dr.Remove(doc) &&
-			           dr.FindOneById(0) == nullptr &&
-				       dr.FindAll().size() == 0;
-			}
-		},
-		{
-			"Positive Test: Retrieval of document",
-			[&] {
-				Database::ResearchDocumentRepository dr;
-				Database::Document doc(0, "a", "b", "c");
-				return dr.Add(doc) &&
-			           dr.FindOneById(0) != nullptr &&
-				       dr.FindAll().size() == 1;
-			}
-		},
-		{
-			"Positive Test: Retrieval of document by author",
-			[&] {
-				Database::ResearchDocumentRepository dr;
-				Database::Document doc(0, "a", "b", "c");
-				return dr.Add(doc) &&
-			           dr.FindManyByAuthor("a").size() == 1 &&
-				       dr.FindAll().size() == 1;
-			}
-		},
-		{
-			"Positive Test: Retrieval of document by title",
-			[&] {
-				Database::ResearchDocumentRepository dr;
-				Database::Document doc(0, "a", "b", "c");
-				return dr.Add(doc) &&
-			           dr.FindManyByTitle("b").size() == 1 &&
-				       dr.FindAll().size() == 1;
-			}
-		},
-		{
-			"Positive Test: Retrieval of documents by author",
-			[&] {
-				Database::ResearchDocumentRepository dr;
-				Database::Document doc1(0, "a", "b", "c");
-				Database::Document doc2(1, "a", "b", "c");
-				Database::Document doc3(3, "a", "b", "c");
-				return dr.Add(doc1) &&
-					   dr.Add(doc2) &&
-					   dr.Add(doc3) &&
-			           dr.FindManyByAuthor("a").size() == 3 &&
-				       dr.FindAll().size() == 3;
-			}
-		},
-		{
-			"Positive Test: Retrieval of documents by title",
-			[&] {
-				Database::ResearchDocumentRepository dr;
-				Database::Document doc1(0, "a", "b", "c");
-				Database::Document doc2(1, "a", "b", "c");
-				Database::Document doc3(3, "a", "b", "c");
-				return dr.Add(doc1) &&
-					   dr.Add(doc2) &&
-					   dr.Add(doc3) &&
-			           dr.FindManyByTitle("b").size() == 3 &&
-				       dr.FindAll().size() == 3;
-			}
-		},
-		{
-			"Positive Test: Retrieval of documents by iterator",
-			[&] {
-				Database::ResearchDocumentRepository dr;
-				Database::Document doc1(0, "a", "b", "c");
-				Database::Document doc2(1, "a", "b", "c");
-				Database::Document doc3(3, "a", "b", "c");
-
-				bool success = dr.Add(doc1) && dr.Add(doc2) && dr.Add(doc3);
-				int count = 0;
-				for(auto it = dr.Begin(); it != dr.End(); ++it) {
-					count++;
-				}
-				return success && count == 3 && dr.FindAll().size() == 3;
-			}
-		},
-		// Negative tests
-		{
-			"Negative Test: Adding multiple documents with same ID",
-			[&] {
-				Database::ResearchDocumentRepository dr;
-				Database::Document doc1(0, "a", "b", "c");
-				Database::Document doc2(0, "a", "b", "c");
-				return dr.Add(doc1) &&
-				       dr.Add(doc2) == false &&
-				       dr.FindOneById(0) != nullptr &&
-				       dr.FindAll().size() == 1;
-			}
-		},
-		{
-			"Negative Test: Retrieval of non-existent document",
-			[&] {
-				Database::ResearchDocumentRepository dr;
-				return dr.FindOneById(0) == nullptr &&
-				       dr.FindAll().size() == 0;
-			}
-		},
-		{
-			"Negative Test: Retrieval by non-existent author",
-			[&] {
-				Database::ResearchDocumentRepository dr;
-				Database::Document doc1(0, "a", "b", "c");
-				return dr.Add(doc1) &&
-				       dr.FindManyByAuthor("aa").size() == 0 &&
-				       dr.FindAll().size() == 1;
-			}
-		},
-		{
-			"Negative Test: Retrieval by non-existent author that previously existed",
-			[&] {
-				Database::ResearchDocumentRepository dr;
-				Database::Document doc1(0, "a", "b", "c");
-				Database::Document doc2(1, "aa", "b", "c");
-				return dr.Add(doc1) &&
-					   dr.Add(doc2) &&
-					   dr.Remove(doc1) &&
-				       dr.FindManyByAuthor("a").size() == 0 &&
-				       dr.FindAll().size() == 1;
-			}
-		},
-		{
-			"Negative Test: Retrieval by non-existent title",
-			[&] {
-				Database::ResearchDocumentRepository dr;
-				Database::Document doc1(0, "a", "b", "c");
-				return dr.Add(doc1) &&
-				       dr.FindManyByTitle("bb").size() == 0 &&
-				       dr.FindAll().size() == 1;
-			}
-		},
-		{
-			"Negative Test: Retrieval by non-existent title that previously existed",
-			[&] {
-				Database::ResearchDocumentRepository dr;
-				Database::Document doc1(0, "a", "b", "c");
-				Database::Document doc2(1, "a", "bb", "c");
-				return dr.Add(doc1) &&
-					   dr.Add(doc2) &&
-					   dr.Remove(doc1) &&
-				       dr.FindManyByTitle("b").size() == 0 &&
-				       dr.FindAll().size() == 1;
-			}
-		},
-		{
-			"Negative Test: Removal of non-existent document",
-			[&] {
-				Database::ResearchDocumentRepository dr;
-				Database::Document doc(0, "a", "b", "c");
-				return !dr.Remove(doc);
-			}
-		},
-
-	};
-
-	// Iterate over and execute tests
-	for (auto test : tests) {
-#ifdef QT_TESTLIB_LIB
-		qDebug() << QString::fromStdString(test.name) << "\n\t" << "Passed: " << test.func() << "\n";
-#else
-		std::cout << test.name << "\n\t" << "Passed: " << test.func() << "\n\n";
-#endif
-	}
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <set>
+#include <map>
+#include <list>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#include <QDebug>
+
+#include "UI/Tests/TestAuthorWidget.hpp"
+#include "UI/Tests/TestDocumentDialog.hpp"
+#include "UI/Tests/TestMainWindow.hpp"
+#include "UI/Tests/TestDocumentViewCache.hpp"
+#include "UI/Tests/TestDocumentTableModel.hpp"
+
+#include "Database/ResearchDocumentRepository.hpp"
+#include "Database/RepositoryHistory.hpp"
+#include "Database/HashIndex.hpp"
+#include "Database/Replication.hpp"
+#include "Database/ShardedDocumentRepository.hpp"
+#include "Database/DirectoryImporter.hpp"
+#include "Database/Trace.hpp"
+#include "Database/Workload.hpp"
+
+/**
+ * Run unit tests for the GUI application
+ */
+void QtUnitTests(int argc, char *argv[])
+{
+	TestAuthorWidget test1;
+	QTest::qExec(&test1, argc, argv);
+
+	TestDocumentDialog test2;
+	QTest::qExec(&test2, argc, argv);
+
+	TestMainWindow test3;
+	QTest::qExec(&test3, argc, argv);
+
+	TestDocumentViewCache test4;
+	QTest::qExec(&test4, argc, argv);
+
+	TestDocumentTableModel test5;
+	QTest::qExec(&test5, argc, argv);
+}
+
+// A minimal entity and index policies, for testing Repository directly
+namespace
+{
+	class Tag
+	{
+	public:
+		Tag(unsigned int id, std::string name, int weight) : id(id), name(name), weight(weight) {
+		}
+
+		unsigned int Id() const { return id; }
+		void SetId(unsigned int id) { this->id = id; }
+
+		unsigned int id;
+		std::string name;
+		int weight;
+	};
+
+	struct ByName {
+		typedef std::string Key;
+
+		template <class Func>
+		static void Extract(const Tag &tag, Func func) {
+			func(tag.name);
+		}
+	};
+
+	struct ByWeight {
+		typedef int Key;
+
+		template <class Func>
+		static void Extract(const Tag &tag, Func func) {
+			func(tag.weight);
+		}
+	};
+
+	typedef Database::Repository<Tag,
+		Database::Index<ByName, Database::Hashed, Database::Unique>,
+		Database::Index<ByWeight, Database::Ordered>> TagRepository;
+
+	// Names, counting how often they're extracted, with a Hash of their own
+	struct ByHashedName {
+		typedef std::string Key;
+
+		static int &Extracted() {
+			static int extracted = 0;
+			return extracted;
+		}
+
+		template <class Func>
+		static void Extract(const Tag &tag, Func func) {
+			++Extracted();
+			func(tag.name);
+		}
+
+		static uint64_t Hash(const Tag &tag) {
+			return Database::Checksum(tag.name.data(), tag.name.size());
+		}
+	};
+}
+
+/**
+ * Run database tests
+ */
+void DatabaseTests()
+{
+	// Store name of test and lambda function to be called
+	// when executing the text.
+	struct {
+		std::string name;
+		std::function<bool()> func;
+	} tests[] = {
+		// Positive tests
+		{ 
+			"Positive Test: Adding document to database",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				Database::Document doc(0, "a", "b", "c");
+				return dr.Add(doc) &&
+				       dr.FindOneById(0) != nullptr &&
+				       dr.FindAll().size() == 1;
+			}
+		},
+		{ 
+			"Positive Test: Adding multiple documents to database",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				Database::Document doc1(0, "a", "b", "c");
+				Database::Document doc2(1, "a", "b", "c");
+				return dr.Add(doc1) &&
+				       dr.Add(doc2) &&
+				       dr.FindOneById(0) != nullptr &&
+					   dr.FindOneById(1) != nullptr &&
+				       dr.FindAll().size() == 2;
+			}
+		},
+		{
+			"Positive Test: Deleting document from database",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				Database::Document doc(0, "a", "b", "c");
+				return dr.Add(doc) &&
+				       dr.Remove(doc) &&
+			           dr.FindOneById(0) == nullptr &&
+				       dr.FindAll().size() == 0;
+			}
+		},
+		{
+			"Positive Test: Retrieval of document",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				Database::Document doc(0, "a", "b", "c");
+				return dr.Add(doc) &&
+			           dr.FindOneById(0) != nullptr &&
+				       dr.FindAll().size() == 1;
+			}
+		},
+		{
+			"Positive Test: Retrieval of document by author",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				Database::Document doc(0, "a", "b", "c");
+				return dr.Add(doc) &&
+			           dr.FindManyByAuthor("a").size() == 1 &&
+				       dr.FindAll().size() == 1;
+			}
+		},
+		{
+			"Positive Test: Retrieval of document by title",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				Database::Document doc(0, "a", "b", "c");
+				return dr.Add(doc) &&
+			           dr.FindManyByTitle("b").size() == 1 &&
+				       dr.FindAll().size() == 1;
+			}
+		},
+		{
+			"Positive Test: Retrieval of documents by author",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				Database::Document doc1(0, "a", "b", "c");
+				Database::Document doc2(1, "a", "b", "c");
+				Database::Document doc3(3, "a", "b", "c");
+				return dr.Add(doc1) &&
+					   dr.Add(doc2) &&
+					   dr.Add(doc3) &&
+			           dr.FindManyByAuthor("a").size() == 3 &&
+				       dr.FindAll().size() == 3;
+			}
+		},
+		{
+			"Positive Test: Retrieval of documents by title",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				Database::Document doc1(0, "a", "b", "c");
+				Database::Document doc2(1, "a", "b", "c");
+				Database::Document doc3(3, "a", "b", "c");
+				return dr.Add(doc1) &&
+					   dr.Add(doc2) &&
+					   dr.Add(doc3) &&
+			           dr.FindManyByTitle("b").size() == 3 &&
+				       dr.FindAll().size() == 3;
+			}
+		},
+		{
+			"Positive Test: Retrieval of documents by iterator",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				Database::Document doc1(0, "a", "b", "c");
+				Database::Document doc2(1, "a", "b", "c");
+				Database::Document doc3(3, "a", "b", "c");
+
+				bool success = dr.Add(doc1) && dr.Add(doc2) && dr.Add(doc3);
+				int count = 0;
+				for(auto it = dr.Begin(); it != dr.End(); ++it) {
+					count++;
+				}
+				return success && count == 3 && dr.FindAll().size() == 3;
+			}
+		},
+		{
+			"Positive Test: Paging through all documents",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				for (unsigned int i = 0; i < 10; ++i) {
+					dr.Add(Database::Document(i, "a", "b", "c"));
+				}
+
+				auto page = dr.FindAll().Page(4, 3);
+				unsigned int expected = 4;
+				for (auto &doc : page) {
+					if (doc.Id() != expected++) {
+						return false;
+					}
+				}
+				return page.size() == 3 &&
+				       dr.FindAll().Page(8, 5).size() == 2 &&
+				       dr.FindAll().Page(12, 5).empty();
+			}
+		},
+		{
+			"Positive Test: Paging through documents by author",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				for (unsigned int i = 0; i < 10; ++i) {
+					dr.Add(Database::Document(i, i % 2 ? "a" : "b", "c", "d"));
+				}
+
+				auto page = dr.FindManyByAuthor("a").Page(1, 10);
+				for (auto &doc : page) {
+					if (doc.Authors().front() != "a") {
+						return false;
+					}
+				}
+				return page.size() == 4 &&
+				       &dr.FindOneById(page.front().Id())->Body() == &page.front().Body();
+			}
+		},
+		{
+			"Positive Test: Adding document by move doesn't copy the body",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				Database::Document doc(0, "a", "b", std::string(1 << 20, 'c'));
+				const char *body = doc.Body().data();
+				return dr.Add(std::move(doc)) &&
+				       dr.FindOneById(0)->Body().data() == body;
+			}
+		},
+		{
+			"Positive Test: Emplacing document into database",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				std::string body(1 << 20, 'c');
+				const char *data = body.data();
+				return dr.Emplace(0u, "a", "b", std::move(body)) &&
+				       dr.FindOneById(0) != nullptr &&
+				       dr.FindOneById(0)->Body().data() == data &&
+				       dr.FindManyByAuthor("a").size() == 1 &&
+				       dr.FindManyByTitle("b").size() == 1;
+			}
+		},
+		{
+			"Positive Test: Setting document body by move doesn't copy",
+			[&] {
+				Database::Document doc(0, "a", "b", "c");
+				std::string body(1 << 20, 'c');
+				const char *data = body.data();
+				doc.SetBody(std::move(body));
+				return doc.Body().data() == data;
+			}
+		},
+		{
+			"Positive Test: Updating document title",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				Database::Document doc(0, "a", "b", "c");
+				return dr.Add(doc) &&
+				       dr.Update(0, [](Database::Document &d) { d.SetTitle("bb"); }) &&
+				       dr.FindManyByTitle("b").size() == 0 &&
+				       dr.FindManyByTitle("bb").size() == 1 &&
+				       dr.FindManyByAuthor("a").size() == 1 &&
+				       dr.FindOneById(0)->Title() == "bb";
+			}
+		},
+		{
+			"Positive Test: Updating document authors",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				Database::Document doc1(0, "a", "b", "c");
+				Database::Document doc2(1, "a", "b", "c");
+				doc1.Authors().push_back("x");
+				return dr.Add(doc1) &&
+				       dr.Add(doc2) &&
+				       dr.Update(0, [](Database::Document &d) {
+				           d.Authors().clear();
+				           d.Authors().push_back("x");
+				           d.Authors().push_back("y");
+				       }) &&
+				       dr.FindManyByAuthor("a").size() == 1 &&
+				       dr.FindManyByAuthor("a").front().Id() == 1 &&
+				       dr.FindManyByAuthor("x").size() == 1 &&
+				       dr.FindManyByAuthor("y").size() == 1;
+			}
+		},
+		{
+			"Positive Test: Updating document body keeps it indexed",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				Database::Document doc(0, "a", "b", "c");
+				return dr.Add(doc) &&
+				       dr.Update(0, [](Database::Document &d) { d.SetBody("cc"); d.SetId(5); }) &&
+				       dr.FindOneById(0)->Body() == "cc" &&
+				       dr.FindOneById(0)->Id() == 0 &&
+				       dr.FindOneById(5) == nullptr &&
+				       &dr.FindManyByTitle("b").front() == dr.FindOneById(0) &&
+				       &dr.FindManyByAuthor("a").front() == dr.FindOneById(0);
+			}
+		},
+		{
+			"Positive Test: Undoing and redoing adding a document",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				Database::RepositoryHistory history(dr);
+				return history.Add(Database::Document(0, "a", "b", "c")) &&
+				       history.Undo() &&
+				       dr.FindOneById(0) == nullptr &&
+				       dr.FindManyByAuthor("a").size() == 0 &&
+				       history.Redo() &&
+				       dr.FindOneById(0) != nullptr &&
+				       dr.FindManyByAuthor("a").size() == 1 &&
+				       !history.CanRedo();
+			}
+		},
+		{
+			"Positive Test: Undoing and redoing removing a document",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				Database::RepositoryHistory history(dr);
+				dr.Add(Database::Document(0, "a", "b", "c"));
+				return history.Remove(0) &&
+				       dr.FindAll().size() == 0 &&
+				       history.Undo() &&
+				       dr.FindOneById(0) != nullptr &&
+				       dr.FindManyByTitle("b").size() == 1 &&
+				       history.Redo() &&
+				       dr.FindOneById(0) == nullptr &&
+				       dr.FindManyByTitle("b").size() == 0;
+			}
+		},
+		{
+			"Positive Test: Undoing and redoing updating a document",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				Database::RepositoryHistory history(dr);
+				dr.Add(Database::Document(0, "a", "b", "c"));
+				return history.Update(0, [](Database::Document &d) { d.SetTitle("bb"); d.SetBody("cc"); }) &&
+				       history.Undo() &&
+				       dr.FindOneById(0)->Title() == "b" &&
+				       dr.FindOneById(0)->Body() == "c" &&
+				       dr.FindManyByTitle("b").size() == 1 &&
+				       dr.FindManyByTitle("bb").size() == 0 &&
+				       history.Redo() &&
+				       dr.FindOneById(0)->Title() == "bb" &&
+				       dr.FindOneById(0)->Body() == "cc" &&
+				       dr.FindManyByTitle("b").size() == 0 &&
+				       dr.FindManyByTitle("bb").size() == 1;
+			}
+		},
+		{
+			"Positive Test: Allocating ids for new documents",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				bool empty = dr.NextId() == 0;
+				dr.Add(Database::Document(0, "a", "b", "c"));
+				dr.Add(Database::Document(7, "a", "b", "c"));
+				return empty &&
+				       dr.NextId() == 8 &&
+				       dr.Add(Database::Document(dr.NextId(), "a", "b", "c")) &&
+				       dr.NextId() == 9;
+			}
+		},
+		{
+			"Positive Test: Reusing ids of removed documents",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				Database::Document doc(3, "a", "b", "c");
+				dr.Add(Database::Document(0, "a", "b", "c"));
+				dr.Add(doc);
+				return dr.Generation(3) == 0 &&
+				       dr.Remove(doc) &&
+				       dr.Generation(3) == 1 &&
+				       dr.NextId() == 3 &&
+				       dr.Add(doc) &&
+				       dr.NextId() == 4;
+			}
+		},
+		{
+			"Positive Test: Retrieval of documents with sparse ids",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				unsigned int ids[] = { 0, 4095, 4096, 1000000, 4000000000u };
+				bool success = true;
+				for (auto id : ids) {
+					success = success && dr.Add(Database::Document(id, "a", "b", "c"));
+				}
+				for (auto id : ids) {
+					success = success && dr.FindOneById(id) != nullptr && dr.FindOneById(id)->Id() == id;
+				}
+				return success &&
+				       dr.FindOneById(1) == nullptr &&
+				       dr.FindOneById(4000000001u) == nullptr &&
+				       dr.FindAll().size() == 5;
+			}
+		},
+		{
+			"Positive Test: Posting lists are kept in order of id",
+			[&] {
+				Database::HashIndex<> hashed;
+				Database::OrderedIndex<int> ordered;
+				for (unsigned int i = 0; i < 2000; ++i) {
+					unsigned int id = (i * 7919) % 2000;
+					hashed.Insert("popular", id);
+					ordered.Insert(1, id);
+				}
+
+				// Remove every third id, in another order
+				bool erased = true;
+				for (unsigned int i = 0; i < 2000; ++i) {
+					unsigned int id = (i * 104729) % 2000;
+					if (id % 3 == 0) {
+						erased = erased && hashed.Erase("popular", id) && ordered.Erase(1, id) &&
+						         !hashed.Erase("popular", id) && !ordered.Erase(1, id);
+					}
+				}
+
+				auto &first = *hashed.Find("popular");
+				auto &second = *ordered.Find(1);
+				return erased && first.size() == 1333 && std::is_sorted(first.begin(), first.end()) &&
+				       std::vector<unsigned int>(first.begin(), first.end()) == std::vector<unsigned int>(second.begin(), second.end()) &&
+				       first.front() == 1 && first.back() == 1999;
+			}
+		},
+		{
+			"Positive Test: Hash index lookups while growing and erasing",
+			[&] {
+				Database::HashIndex<> index;
+				for (unsigned int i = 0; i < 5000; ++i) {
+					index.Insert("key" + std::to_string(i % 1000), i);
+				}
+
+				bool success = index.Size() == 1000;
+				for (unsigned int i = 0; i < 1000; ++i) {
+					auto ids = index.Find("key" + std::to_string(i));
+					success = success && ids != nullptr && ids->size() == 5 && ids->front() == i;
+				}
+
+				// Erase every id of every other key, leaving deleted slots behind
+				for (unsigned int i = 0; i < 5000; ++i) {
+					if (i % 2 == 0) {
+						success = success && index.Erase("key" + std::to_string(i % 1000), i);
+					}
+				}
+				for (unsigned int i = 0; i < 1000; i += 2) {
+					success = success && index.Find("key" + std::to_string(i)) == nullptr;
+				}
+
+				// Reinsert, which reuses deleted slots
+				for (unsigned int i = 0; i < 1000; i += 2) {
+					index.Insert("key" + std::to_string(i), i);
+				}
+
+				size_t keys = 0, ids = 0;
+				index.ForEach([&](const std::string &, const Database::HashIndex<>::Postings &postings) {
+					keys++;
+					ids += postings.size();
+				});
+				return success && index.Size() == 1000 && keys == 1000 && ids == 3000;
+			}
+		},
+		{
+			"Positive Test: Repository with unique and ordered index policies",
+			[&] {
+				TagRepository repository;
+				repository.Add(Tag(0, "a", 3));
+				repository.Add(Tag(1, "b", 1));
+				repository.Add(Tag(2, "c", 3));
+
+				// Ordered index holds weights in order
+				std::vector<int> weights;
+				for (auto &entry : repository.GetIndex<ByWeight>().Keys().Keys()) {
+					weights.push_back(entry.first);
+				}
+
+				return repository.FindManyBy<ByName>("b").size() == 1 &&
+				       repository.FindManyBy<ByWeight>(3).size() == 2 &&
+				       weights.size() == 2 && weights[0] == 1 && weights[1] == 3 &&
+				       repository.Update(1, [](Tag &tag) { tag.name = "d"; tag.weight = 3; }) &&
+				       repository.FindManyBy<ByName>("b").empty() &&
+				       repository.FindManyBy<ByName>("d").front().Id() == 1 &&
+				       repository.FindManyBy<ByWeight>(1).empty() &&
+				       repository.FindManyBy<ByWeight>(3).size() == 3;
+			}
+		},
+		{
+			"Positive Test: Saving and loading secondary indexes",
+			[&] {
+				const std::string path = "test_indexes.rdix";
+
+				TagRepository saved;
+				for (unsigned int i = 0; i < 200; ++i) {
+					saved.Add(Tag(i, "tag" + std::to_string(i), i % 7));
+				}
+				saved.Remove(*saved.FindOneById(5));
+				bool written = saved.SaveIndexes(path);
+
+				// Same entities, added in another order without indexing
+				TagRepository loaded;
+				loaded.DeferIndexing();
+				for (unsigned int i = 200; i-- > 0;) {
+					if (i != 5) {
+						loaded.Add(Tag(i, "tag" + std::to_string(i), i % 7));
+					}
+				}
+				bool unindexed = loaded.FindManyBy<ByName>("tag1").empty();
+				bool fromFile = loaded.LoadIndexes(path);
+				std::remove(path.c_str());
+
+				return written && unindexed && fromFile &&
+				       loaded.Fingerprint() == saved.Fingerprint() &&
+				       loaded.FindManyBy<ByName>("tag1").front().Id() == 1 &&
+				       loaded.FindManyBy<ByName>("tag5").empty() &&
+				       loaded.FindManyBy<ByWeight>(3).size() == saved.FindManyBy<ByWeight>(3).size() &&
+				       !loaded.Add(Tag(300, "tag7", 0)) &&
+				       loaded.Add(Tag(5, "tag5", 5));
+			}
+		},
+		{
+			"Positive Test: Fingerprinting bodies without signing them",
+			[&] {
+				Database::Document doc(0, "a", "b", "some body text");
+				bool cheap = Database::Index<Database::ByBodyBand>::Hash(doc) == Database::Checksum(doc.Body().data(), doc.Body().size());
+
+				// Bodies still count towards the fingerprint
+				Database::ResearchDocumentRepository first, second;
+				first.Add(doc);
+				second.Add(Database::Document(0, "a", "b", "another body"));
+				bool differs = first.Fingerprint() != second.Fingerprint();
+				second.Update(0, [](Database::Document &stored) { stored.SetBody("some body text"); });
+
+				return cheap && differs && first.Fingerprint() == second.Fingerprint();
+			}
+		},
+		{
+			"Positive Test: Changes that keep an extractor's hash aren't extracted again",
+			[&] {
+				Database::Repository<Tag, Database::Index<ByHashedName>> repository;
+				repository.Add(Tag(0, "name", 1));
+
+				// Only the keys before the change are extracted
+				ByHashedName::Extracted() = 0;
+				repository.Update(0, [](Tag &tag) { tag.weight = 2; });
+				bool skipped = ByHashedName::Extracted() == 1;
+
+				ByHashedName::Extracted() = 0;
+				repository.Update(0, [](Tag &tag) { tag.name = "renamed"; });
+				bool reindexed = ByHashedName::Extracted() == 2;
+
+				return skipped && reindexed &&
+				       repository.FindManyBy<ByHashedName>("renamed").size() == 1 &&
+				       repository.FindManyBy<ByHashedName>("name").empty();
+			}
+		},
+		{
+			"Positive Test: Building indexes in the background",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				dr.DeferIndexing();
+				for (unsigned int i = 0; i < 5000; ++i) {
+					dr.Add(Database::Document(i, "author" + std::to_string(i % 50), "title" + std::to_string(i), "body"));
+				}
+				dr.BuildIndexesInBackground();
+
+				// Storage is readable straight away, and queries wait for their index
+				bool all = dr.FindAll().size() == 5000 && dr.FindOneById(42) != nullptr;
+				bool found = dr.FindManyByAuthor("author7").size() == 100 &&
+				             dr.FindManyByTitle("title4999").front().Id() == 4999;
+
+				// Changes wait for every index
+				bool added = dr.Add(Database::Document(5000, "author7", "title5000", "body"));
+				return all && found && added && dr.IndexesReady() &&
+				       dr.FindManyByAuthor("author7").size() == 101;
+			}
+		},
+		{
+			"Positive Test: Replicating changes through a feed file",
+			[&] {
+				const std::string path = "test_feed.log";
+
+				Database::ResearchDocumentRepository primary;
+				primary.Add(Database::Document(0, "a", "b", "c"));
+
+				std::ofstream out(path, std::ios::binary | std::ios::trunc);
+				std::ifstream in;
+				bool caughtUp = false, incomplete = false;
+				{
+					Database::ChangeFeed feed(primary, out);
+					primary.Add(Database::Document(1, "d", "e", "f"));
+
+					Database::ResearchDocumentRepository follower;
+					in.open(path, std::ios::binary);
+					Database::ReplicationFollower replica(follower, in);
+					caughtUp = replica.Poll() == 2 && follower.Size() == 2;
+
+					primary.Update(1, [](Database::Document &doc) { doc.Authors().push_back("g"); });
+					primary.Remove(*primary.FindOneById(0));
+
+					// Records are read ahead without being applied
+					bool pending = replica.Pending() && follower.Size() == 2;
+
+					// Half a record is left until the rest is written
+					out.write("\x10\x00", 2);
+					out.flush();
+					incomplete = pending && replica.Poll() == 2 && replica.Poll() == 0 && !replica.Pending() && !replica.Progress().failed;
+
+					// An idle follower falls further behind
+					auto lag = replica.Progress().lag;
+					std::this_thread::sleep_for(std::chrono::milliseconds(20));
+					bool growing = replica.Progress().lag >= lag + std::chrono::milliseconds(20);
+
+					caughtUp = caughtUp && incomplete && growing &&
+					           replica.Progress().applied == feed.Sequence() &&
+					           follower.Size() == 1 &&
+					           follower.FindManyByAuthor("g").size() == 1 &&
+					           follower.FindOneById(1)->Title() == "e";
+				}
+				in.close();
+				out.close();
+				std::remove(path.c_str());
+
+				return caughtUp;
+			}
+		},
+		{
+			"Positive Test: Work-stealing thread pool",
+			[&] {
+				Database::ThreadPool pool(4);
+
+				// Tasks spawning tasks of their own, which idle workers steal
+				std::vector<std::future<int>> outer;
+				for (int i = 0; i < 8; ++i) {
+					outer.push_back(pool.Submit([&pool, i] {
+						std::vector<std::future<int>> inner;
+						for (int j = 0; j < 100; ++j) {
+							inner.push_back(pool.Submit([i, j] { return i * j; }));
+						}
+						return 0;
+					}));
+				}
+
+				std::atomic<int> sum(0);
+				std::vector<std::future<void>> tasks;
+				for (int i = 1; i <= 1000; ++i) {
+					tasks.push_back(pool.Submit([&sum, i] { sum += i; }));
+				}
+				for (auto &task : tasks) {
+					task.get();
+				}
+				for (auto &task : outer) {
+					task.get();
+				}
+				return pool.Size() == 4 && sum == 500500;
+			}
+		},
+		{
+			"Positive Test: Sharded repository matches a single repository",
+			[&] {
+				Database::ShardedDocumentRepository sharded(4);
+				Database::ResearchDocumentRepository single;
+				for (unsigned int i = 0; i < 2000; ++i) {
+					Database::Document doc(i, "author" + std::to_string(i % 13), "title" + std::to_string(i % 7), i % 5 == 0 ? "needle" : "hay");
+					sharded.Add(doc);
+					single.Add(doc);
+				}
+				sharded.Remove(*sharded.FindOneById(26));
+				single.Remove(*single.FindOneById(26));
+				sharded.Update(39, [](Database::Document &doc) { doc.Authors().push_back("author1"); });
+				single.Update(39, [](Database::Document &doc) { doc.Authors().push_back("author1"); });
+
+				// Results arrive in order of id
+				auto same = [](const Database::ShardedDocumentRepository::Results &results, std::vector<unsigned int> expected) {
+					std::sort(expected.begin(), expected.end());
+					if (results.size() != expected.size()) {
+						return false;
+					}
+					for (size_t i = 0; i < results.size(); ++i) {
+						if (results[i]->Id() != expected[i]) {
+							return false;
+						}
+					}
+					return true;
+				};
+				auto ids = [](const Database::ResearchDocumentRepository::IndexView &view) {
+					std::vector<unsigned int> ids;
+					for (auto &doc : view) {
+						ids.push_back(doc.Id());
+					}
+					return ids;
+				};
+
+				std::vector<unsigned int> needles;
+				for (auto &doc : single.FindAll()) {
+					if (doc.Body() == "needle") {
+						needles.push_back(doc.Id());
+					}
+				}
+
+				// Ids are spread across the shards in blocks
+				Database::ShardedDocumentRepository blocks(4);
+				for (unsigned int i = 0; i < 2000; ++i) {
+					blocks.Add(Database::Document(i * 64, "author", "title", "body"));
+				}
+				bool spread = sharded.Shard(0).Size() == 1999;
+				for (size_t i = 0; i < blocks.ShardCount(); ++i) {
+					spread = spread && blocks.Shard(i).Size() > 400;
+				}
+
+				return spread && sharded.Size() == 1999 && sharded.NextId() == 2000 &&
+				       sharded.FindOneById(26) == nullptr &&
+				       sharded.FindOneById(27)->Id() == 27 &&
+				       sharded.FindAll().size() == 1999 &&
+				       same(sharded.FindManyByAuthor("author1"), ids(single.FindManyByAuthor("author1"))) &&
+				       same(sharded.FindManyByTitle("title3"), ids(single.FindManyByTitle("title3"))) &&
+				       same(sharded.FindBodiesContaining("needle"), needles);
+			}
+		},
+		{
+			"Positive Test: Memory accounting of storage and indexes",
+			[&] {
+				TagRepository repository;
+				Database::MemoryReport empty = repository.Memory();
+
+				for (unsigned int i = 0; i < 1000; ++i) {
+					repository.Add(Tag(i, "tag" + std::to_string(i), i % 10));
+				}
+				Database::MemoryReport full = repository.Memory();
+
+				for (unsigned int i = 0; i < 1000; ++i) {
+					repository.Remove(*repository.FindOneById(i));
+				}
+				Database::MemoryReport removed = repository.Memory();
+
+				return empty.storage == 0 && empty.indexes.size() == 2 &&
+				       full.storage >= 1000 * sizeof(Tag) &&
+				       full.ids > 0 &&
+				       full.indexes[0] > 1000 * sizeof(unsigned int) &&
+				       full.indexes[1] > 1000 * sizeof(unsigned int) &&
+				       full.Total() > full.storage + full.ids &&
+				       removed.storage == 0 &&
+				       removed.indexes[1] == 0;
+			}
+		},
+		{
+			"Positive Test: Evicting bodies over a memory budget",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				dr.SetMemoryBudget(100000, "test_spill.bin");
+
+				for (unsigned int i = 0; i < 100; ++i) {
+					dr.Add(Database::Document(i, "a", "b", std::string(10000, static_cast<char>('a' + i % 26)) + std::to_string(i)));
+				}
+				bool evicted = dr.BodyMemory() <= 100000 && dr.SpilledMemory() >= 900000;
+
+				// Evicted bodies are reloaded when read
+				bool reloaded = true;
+				for (unsigned int i = 0; i < 100; ++i) {
+					auto &body = dr.FindOneById(i)->Body();
+					reloaded = reloaded && body.size() == 10000 + std::to_string(i).size() && body[0] == static_cast<char>('a' + i % 26);
+				}
+
+				size_t found = 0;
+				dr.ScanBodies("z25", [&](const Database::ResearchDocumentRepository::ScanMatch &) {
+					++found;
+					return true;
+				});
+
+				dr.EnforceMemoryBudget();
+				bool enforced = dr.BodyMemory() <= 100000;
+
+				// Copies hold their bodies themselves
+				Database::Document copy = *dr.FindOneById(3);
+				dr.SetMemoryBudget(0, "");
+				return evicted && reloaded && found == 1 && enforced &&
+				       copy.Resident() && copy.Body()[0] == 'd' &&
+				       dr.BodyMemory() >= 1000000 && dr.SpilledMemory() == 0;
+			}
+		},
+		{
+			"Positive Test: Reading an evicted body from many threads at once",
+			[&] {
+				Database::SpillStore store("test_spill_threads.bin");
+				Database::Document doc(0, "a", "b", std::string(1000, 'x'));
+
+				// Every thread finds the body, however the reload falls between them
+				std::atomic<int> wrong(0);
+				for (int round = 0; round < 500; ++round) {
+					doc.Evict(store);
+					std::atomic<int> waiting(4);
+					std::vector<std::thread> readers;
+					for (int i = 0; i < 4; ++i) {
+						readers.emplace_back([&] {
+							// Start reading together
+							--waiting;
+							while (waiting > 0) {
+								std::this_thread::yield();
+							}
+							if (doc.Body().size() != 1000) {
+								++wrong;
+							}
+						});
+					}
+					for (auto &reader : readers) {
+						reader.join();
+					}
+				}
+				return wrong == 0 && doc.Resident();
+			}
+		},
+		{
+			"Positive Test: Moving an evicted document leaves its body evicted",
+			[&] {
+				Database::SpillStore store("test_spill_move.bin");
+				Database::Document doc(0, "a", "b", std::string(1000, 'x'));
+				doc.Evict(store);
+
+				Database::Document moved(std::move(doc));
+				bool constructed = !moved.Resident() && doc.Resident();
+
+				Database::Document assigned(1, "a", "b", "body");
+				assigned = std::move(moved);
+				bool evicted = !assigned.Resident() && moved.Resident();
+
+				return constructed && evicted && assigned.Body() == std::string(1000, 'x') && assigned.Resident();
+			}
+		},
+		{
+			"Positive Test: Versions change with every add and update",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				dr.Add(Database::Document(0, "a", "b", "c"));
+				unsigned int added = dr.Version(0);
+
+				dr.Update(0, [](Database::Document &doc) { doc.SetBody("d"); });
+				unsigned int updated = dr.Version(0);
+
+				dr.Remove(*dr.FindOneById(0));
+				dr.Add(Database::Document(0, "a", "b", "c"));
+				return added != 0 && updated != added && dr.Version(0) != added && dr.Version(0) != updated;
+			}
+		},
+		{
+			"Positive Test: Finding documents by word prefixes",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				dr.Add(Database::Document(0, "Edwin Dusty",     "A Title",             "Document Text"));
+				dr.Add(Database::Document(1, "Jarrod Otis",     "A Title: The Sequel", "Document Text"));
+				dr.Add(Database::Document(2, "Harland Raymond", "A SHOUTY TITLE",      "Document Text"));
+				dr.Add(Database::Document(3, "Edwin Raymond",   "Another Story",       "Document Text"));
+				dr.Update(3, [](Database::Document &doc) { doc.SetTitle("Another Sequel"); });
+
+				auto ids = [&](const std::string &query) {
+					std::vector<unsigned int> ids;
+					for (auto doc : dr.FindMatching(query)) {
+						ids.push_back(doc->Id());
+					}
+					return ids;
+				};
+
+				return ids("tit") == std::vector<unsigned int>({ 0, 1, 2 }) &&
+				       ids("  SEQ, ray ") == std::vector<unsigned int>({ 3 }) &&
+				       ids("edwin") == std::vector<unsigned int>({ 0, 3 }) &&
+				       ids("story").empty() && ids("").empty() && ids("titles").empty();
+			}
+		},
+		{
+			"Positive Test: Facet counts follow changes",
+			[&] {
+				// 2000-02-29, 2000-12-31 23:59:59 and 2001-01-01
+				Database::ResearchDocumentRepository dr;
+				dr.Add(Database::Document(0, "Edwin Dusty",     "A Title", "Document Text", 951782400));
+				dr.Add(Database::Document(1, "Jarrod Otis",     "A Title", "Document Text", 978307199));
+				dr.Add(Database::Document(2, "Edwin Dusty",     "A Title", "Document Text", 978307200));
+				dr.Add(Database::Document(3, "Harland Raymond", "A Title", "Document Text", 978307200));
+				dr.Update(1, [](Database::Document &doc) { doc.Authors().push_back("Edwin Dusty"); });
+				dr.Remove(*dr.FindOneById(3));
+
+				auto authors = dr.CountByAuthor();
+				std::sort(authors.begin(), authors.end());
+
+				Database::IdSet within;
+				within.Insert(1);
+				within.Insert(2);
+				within.Insert(1000);
+
+				// Sparse ids only take pages of the bitmap near them
+				Database::IdSet sparse;
+				sparse.Insert(4000000000u);
+				sparse.Insert(4000000000u);
+				bool paged = sparse.Size() == 1 && sparse.Contains(4000000000u) && !sparse.Contains(3999999999u) && !sparse.Contains(1);
+
+				typedef std::vector<std::pair<std::string, size_t>> AuthorCounts;
+				typedef std::vector<std::pair<int, size_t>> YearCounts;
+				return authors == AuthorCounts({ { "Edwin Dusty", 3 }, { "Jarrod Otis", 1 } }) &&
+				       dr.CountByYear() == YearCounts({ { 2000, 2 }, { 2001, 1 } }) &&
+				       dr.CountByYear(within) == YearCounts({ { 2000, 1 }, { 2001, 1 } }) &&
+				       dr.CountByAuthor(within).size() == 2 &&
+				       within.Size() == 3 && !within.Contains(3) && !within.Contains(5000) && paged &&
+				       Database::ByYear::Year(0) == 1970 && Database::ByYear::Year(-1) == 1969;
+			}
+		},
+		{
+			"Positive Test: Top-k queries match a full sort",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				Database::IdSet odd;
+				for (unsigned int i = 0; i < 3000; ++i) {
+					std::time_t published = 946684800 + static_cast<std::time_t>((i * 7919) % 3000) * 86400 * 3;
+					dr.Add(Database::Document(i, "author" + std::to_string(i * i % 37), "A Title", "Document Text", published));
+					if (i % 2 == 1) {
+						odd.Insert(i);
+					}
+				}
+
+				// Expected results, by sorting everything
+				std::vector<const Database::Document*> all, oddOnly;
+				for (auto &doc : dr.FindAll()) {
+					all.push_back(&doc);
+					if (doc.Id() % 2 == 1) {
+						oddOnly.push_back(&doc);
+					}
+				}
+				auto newer = [](const Database::Document *a, const Database::Document *b) {
+					return a->Published() > b->Published() || (a->Published() == b->Published() && a->Id() < b->Id());
+				};
+				std::sort(all.begin(), all.end(), newer);
+				std::sort(oddOnly.begin(), oddOnly.end(), newer);
+				all.resize(50);
+				oddOnly.resize(50);
+
+				auto authors = dr.CountByAuthor();
+				std::sort(authors.begin(), authors.end(), [](const std::pair<std::string, size_t> &a, const std::pair<std::string, size_t> &b) {
+					return a.second > b.second || (a.second == b.second && a.first < b.first);
+				});
+				authors.resize(5);
+
+				auto top = dr.MostProlificAuthors(5);
+				auto topOdd = dr.MostProlificAuthors(100, odd);
+				size_t oddTotal = 0;
+				for (auto &author : topOdd) {
+					oddTotal += author.second;
+				}
+
+				return dr.MostRecent(50) == all && dr.MostRecent(50, odd) == oddOnly &&
+				       dr.MostRecent(5000).size() == 3000 && dr.MostRecent(0).empty() &&
+				       top == authors && oddTotal == 1500 && dr.MostProlificAuthors(0).empty();
+			}
+		},
+		{
+			"Positive Test: Finding near-duplicate bodies",
+			[&] {
+				// Distinct bodies of 200 words, and re-uploads changing a few words
+				auto body = [](unsigned int seed, unsigned int changed) {
+					std::string text;
+					for (unsigned int w = 0; w < 200; ++w) {
+						unsigned int word = (w * 7 + seed * 131) * 2654435761u % 100000;
+						text += "word" + std::to_string(w < changed ? word + 1 : word) + (w % 10 == 9 ? ". " : " ");
+					}
+					return text;
+				};
+
+				Database::ResearchDocumentRepository dr;
+				for (unsigned int i = 0; i < 500; ++i) {
+					dr.Add(Database::Document(i, "Author", "Title", body(i, 0)));
+				}
+				dr.Add(Database::Document(500, "Author", "Title (Revised)", body(7, 3)));
+				dr.Add(Database::Document(501, "Author", "Title", body(7, 0)));
+				dr.Add(Database::Document(502, "Author", "Title", ""));
+
+				auto ofSeven = dr.FindNearDuplicates(7);
+				auto all = dr.FindAllNearDuplicates();
+
+				// Checking a document before it's added
+				Database::Document upload(503, "Author", "Title", body(42, 2));
+				auto beforeAdd = dr.FindNearDuplicates(upload);
+
+				std::set<unsigned int> ids;
+				for (auto &duplicate : ofSeven) {
+					ids.insert(duplicate.document->Id());
+				}
+
+				return ids == std::set<unsigned int>({ 500, 501 }) &&
+				       ofSeven[0].similarity >= ofSeven[1].similarity && ofSeven[1].similarity >= 0.8 &&
+				       all.size() == 3 && all[0].first->Id() < all[0].second->Id() &&
+				       beforeAdd.size() == 1 && beforeAdd[0].document->Id() == 42 &&
+				       dr.FindNearDuplicates(502).empty() && dr.FindNearDuplicates(1000).empty();
+			}
+		},
+		{
+			"Positive Test: Importing a directory of files",
+			[&] {
+				namespace fs = Database::filesystem;
+				fs::create_directories("test_import/papers/older");
+				std::ofstream("test_import/notes.txt") << "Some notes";
+				std::ofstream("test_import/papers/first.txt") << "The first paper";
+				std::ofstream("test_import/papers/older/second.txt") << "The second paper";
+				std::ofstream("test_import/manifest.tsv") <<
+					"papers/first.txt\tA First Paper\tEdwin Dusty; Jarrod Otis\t1136073600\r\n"
+					"papers/older/second.txt\tA Second Paper\tHarland Raymond\t946684800\n"
+					"papers/missing.txt\tA Missing Paper\tNobody\t0\n";
+
+				Database::ResearchDocumentRepository dr;
+				dr.Add(Database::Document(0, "Andrew Bishop", "Already Here", "Document Text"));
+
+				Database::DirectoryImporter importer(dr, 4);
+				bool started = importer.Start("test_import");
+				size_t added = importer.Run();
+				auto status = importer.Progress();
+
+				auto first = dr.FindManyByTitle("A First Paper");
+				auto second = dr.FindManyByTitle("A Second Paper");
+				auto notes = dr.FindManyByTitle("notes.txt");
+
+				Database::DirectoryImporter missing(dr);
+				bool missingStarted = missing.Start("test_import/none");
+
+				fs::remove_all("test_import");
+				return started && added == 3 && dr.Size() == 4 && importer.Finished() &&
+				       status.files == 3 && status.read == 3 && status.failed == 0 && status.bytes == 41 && status.listed &&
+				       first.size() == 1 && first.begin()->Body() == "The first paper" &&
+				       first.begin()->Authors() == Database::Document::AuthorList({ "Edwin Dusty", "Jarrod Otis" }) &&
+				       first.begin()->Published() == 1136073600 && first.begin()->Id() != 0 &&
+				       second.size() == 1 && second.begin()->Published() == 946684800 &&
+				       notes.size() == 1 && notes.begin()->Authors()[0] == "Unknown" &&
+				       !missingStarted && missing.Run() == 0;
+			}
+		},
+		{
+			"Positive Test: Importing holds back reading until documents are added",
+			[&] {
+				namespace fs = Database::filesystem;
+				fs::create_directories("test_import_held");
+				for (int i = 0; i < 20; ++i) {
+					std::ofstream("test_import_held/" + std::to_string(i) + ".txt") << "Paper " << i;
+				}
+
+				// With no room, each reader only reads a file once nothing is waiting
+				Database::ResearchDocumentRepository dr;
+				Database::DirectoryImporter importer(dr, 2, 1);
+				bool started = importer.Start("test_import_held");
+				while (importer.Progress().read == 0) {
+					std::this_thread::yield();
+				}
+				std::this_thread::sleep_for(std::chrono::milliseconds(50));
+				bool held = importer.Progress().read <= 2 && !importer.Finished();
+				bool stepped = importer.Ready() && importer.StepFor(std::chrono::milliseconds(10)) > 0;
+
+				size_t added = importer.Run();
+				fs::remove_all("test_import_held");
+				return started && held && stepped && added == 20 && dr.Size() == 20 && importer.Progress().read == 20;
+			}
+		},
+		{
+			"Positive Test: Trace spans export as Chrome trace events",
+			[&] {
+				bool wasEnabled = Database::Trace::Enabled();
+				Database::Trace::Clear();
+
+				Database::ResearchDocumentRepository dr;
+				Database::Trace::Enable(false);
+				dr.Add(Database::Document(0, "Andrew Bishop", "Untraced", "Document Text"));
+				std::ostringstream untraced;
+				Database::Trace::Export(untraced);
+
+				Database::Trace::Enable();
+				dr.Add(Database::Document(1, "Andrew Bishop", "Traced", "Document Text"));
+				{
+					Database::ThreadPool pool(2);
+					pool.Submit([] { Database::TraceSpan span("Test \"quoted\""); }).wait();
+				}
+				std::ostringstream traced;
+				Database::Trace::Export(traced);
+
+				Database::Trace::Clear();
+				Database::Trace::Enable(wasEnabled);
+
+				std::string json = traced.str();
+				return untraced.str().find("\"ph\"") == std::string::npos &&
+				       json.find("{\"traceEvents\":[") == 0 &&
+				       json.find("\"name\":\"Repository::Add\",\"ph\":\"X\"") != std::string::npos &&
+				       json.find("\"name\":\"Test \\\"quoted\\\"\"") != std::string::npos;
+			}
+		},
+		{
+			"Positive Test: Replaying a recorded workload",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				dr.Add(Database::Document(0, "Edwin Dusty", "Database Design", "Document Text", 946684800));
+
+				std::stringstream recorded, anonymized;
+				size_t records = 0;
+				{
+					Database::WorkloadRecorder recorder(dr, recorded);
+					Database::WorkloadRecorder anonymous(dr, anonymized, true);
+					dr.Add(Database::Document(1, "Jarrod Otis", "Data Structures", "Some longer document text"));
+					dr.Add(Database::Document(2, "Harland Raymond", "Compilers", "Document Text"));
+					dr.Update(1, [](Database::Document &doc) { doc.SetTitle("Data Structures, Revised"); });
+					dr.Remove(*dr.FindOneById(2));
+					for (auto recording : { &recorder, &anonymous }) {
+						recording->Find(Database::WorkloadOperation::FindMatching, "dat");
+						recording->Find(Database::WorkloadOperation::FindByAuthor, "Edwin Dusty");
+						recording->Facets(true);
+					}
+					records = recorder.Size();
+				}
+
+				Database::ResearchDocumentRepository replayed, anonymous;
+				Database::WorkloadReplay replay(replayed), anonymousReplay(anonymous);
+				bool read = replay.Read(recorded) && anonymousReplay.Read(anonymized);
+				replay.Run();
+				anonymousReplay.Run();
+
+				std::map<std::string, size_t> counts;
+				for (auto &latencies : replay.Summary()) {
+					counts[Database::WorkloadOperationName(latencies.operation)] = latencies.count - latencies.failed;
+				}
+				std::ostringstream report;
+				replay.Report(report);
+
+				auto revised = replayed.FindOneById(1);
+				auto hidden = anonymous.FindOneById(1);
+				return read && records == 8 && replay.Size() == 8 && replay.Complete() && !replay.Anonymized() && anonymousReplay.Anonymized() &&
+				       counts == std::map<std::string, size_t>({ { "Load", 1 }, { "Add", 2 }, { "Update", 1 }, { "Remove", 1 }, { "FindMatching", 1 }, { "FindByAuthor", 1 }, { "Facets", 1 } }) &&
+				       report.str().find("FindMatching") != std::string::npos &&
+				       replayed.Size() == 2 && revised != nullptr && revised->Title() == "Data Structures, Revised" && revised->Body() == "Some longer document text" &&
+				       anonymous.Size() == 2 && hidden != nullptr && hidden->Body().size() == revised->Body().size() &&
+				       hidden->Title() == Database::WorkloadRecorder::Anonymize("Data Structures, Revised") && hidden->Title().find("Data") == std::string::npos &&
+				       anonymous.FindMatching(Database::WorkloadRecorder::Anonymize("dat")).size() == replayed.FindMatching("dat").size() &&
+				       replayed.FindMatching("dat").size() == 2;
+			}
+		},
+		{
+			"Positive Test: Pooled allocation reuses freed nodes",
+			[&] {
+				auto allocator = Database::NewPooledAllocator<Database::Document>();
+				std::list<Database::Document, Database::TrackingAllocator<Database::Document>> documents(allocator);
+				for (unsigned int i = 0; i < 1000; ++i) {
+					documents.emplace_back(i, "Andrew Bishop", "A Title", "Document Text");
+				}
+				size_t full = allocator.Bytes();
+				size_t reserved = allocator.Counter()->Pool()->Reserved();
+
+				// Freed nodes are taken again, rather than growing the pool
+				documents.erase(std::next(documents.begin(), 500), documents.end());
+				for (unsigned int i = 0; i < 500; ++i) {
+					documents.emplace_back(i, "Andrew Bishop", "A Title", "Document Text");
+				}
+				bool reused = allocator.Counter()->Pool()->Reserved() == reserved && allocator.Bytes() == full;
+
+				// Blocks too large for the pool come from the heap
+				std::vector<char, Database::TrackingAllocator<char>> large(Database::NodePool::Largest + 1, 'x', allocator);
+				bool heap = allocator.Counter()->Pool()->Reserved() == reserved;
+
+				Database::NodePool pool;
+				void *first = pool.Allocate(24);
+				void *second = pool.Allocate(24);
+				pool.Deallocate(first, 24);
+				void *again = pool.Allocate(32);
+
+				return full >= 1000 * sizeof(Database::Document) && reserved >= full && reused && heap &&
+				       large.get_allocator().Bytes() == full + large.size() &&
+				       first != second && again == first &&
+				       reinterpret_cast<uintptr_t>(first) % Database::NodePool::Alignment == 0 &&
+				       reinterpret_cast<uintptr_t>(second) % Database::NodePool::Alignment == 0;
+			}
+		},
+		{
+			"Positive Test: Authors are held inline until they outgrow the document",
+			[&] {
+				auto within = [](const Database::Document &doc) {
+					auto author = reinterpret_cast<const char*>(&doc.Authors()[0]);
+					auto start = reinterpret_cast<const char*>(&doc);
+					return author >= start && author < start + sizeof(doc);
+				};
+
+				Database::Document doc(0, "Edwin Dusty", "A Title", "Document Text");
+				doc.Authors().push_back("Jarrod Otis");
+				bool inlined = within(doc) && doc.Authors().IsInline();
+
+				// A third author moves the list to the heap
+				doc.Authors().push_back(doc.Authors()[0]);
+				bool grown = !within(doc) && doc.Authors().size() == 3 && doc.Authors()[2] == "Edwin Dusty";
+
+				Database::Document copy(doc), moved(std::move(doc));
+				Database::Document shorter(1, "Harland Raymond", "A Title", "Document Text");
+				Database::Document assigned(shorter);
+				assigned = std::move(shorter);
+
+				return inlined && grown && copy.Authors() == moved.Authors() && doc.Authors().empty() &&
+				       moved.Authors() == Database::Document::AuthorList({ "Edwin Dusty", "Jarrod Otis", "Edwin Dusty" }) &&
+				       assigned.Authors().size() == 1 && assigned.Authors().front() == "Harland Raymond" && within(assigned) &&
+				       copy.Authors() < assigned.Authors() && assigned.Authors() > copy.Authors();
+			}
+		},
+		{
+			"Positive Test: Metadata columns follow changes",
+			[&] {
+				const std::string path = "test_columns.rdix";
+
+				Database::ResearchDocumentRepository dr;
+				for (unsigned int i = 0; i < 300; ++i) {
+					dr.Add(Database::Document(i * 3, "Author" + std::to_string(i % 7), "Title" + std::to_string(i), "Body", 1000 + i));
+				}
+				dr.Add(Database::Document(4000000000u, "Sparse Author", "Sparse", "Body", 2000));
+				for (unsigned int i = 0; i < 300; i += 4) {
+					dr.Remove(*dr.FindOneById(i * 3));
+				}
+
+				// Retitling documents many times leaves title text to be reclaimed
+				for (int round = 0; round < 20; ++round) {
+					for (unsigned int i = 1; i < 300; i += 4) {
+						dr.Update(i * 3, [&](Database::Document &doc) {
+							doc.SetTitle("Retitled " + std::to_string(round) + " " + std::to_string(i));
+							doc.SetPublished(5000 + i);
+							doc.Authors().front() = "New Author";
+						});
+					}
+				}
+
+				// Every document's row matches the document itself
+				const Database::MetadataColumns &columns = dr.Columns();
+				bool matches = columns.Size() == dr.Size() && columns.Row(0) == Database::MetadataColumns::npos;
+				for (auto &doc : dr.FindAll()) {
+					size_t row = columns.Row(doc.Id());
+					matches = matches && row != Database::MetadataColumns::npos && columns.Ids()[row] == doc.Id() &&
+					          columns.Published()[row] == doc.Published() && columns.Title(row) == doc.Title() &&
+					          columns.AuthorName(columns.FirstAuthors()[row]) == doc.Authors().front();
+				}
+
+				std::set<unsigned int> expected, found;
+				for (auto &doc : dr.FindAll()) {
+					if (doc.Published() >= 1100 && doc.Published() < 5100) {
+						expected.insert(doc.Id());
+					}
+				}
+				for (auto doc : dr.FindPublishedBetween(1100, 5100)) {
+					found.insert(doc->Id());
+				}
+
+				// The columns are saved and loaded with the indexes
+				dr.SaveIndexes(path);
+				Database::ResearchDocumentRepository loaded;
+				loaded.DeferIndexing();
+				for (auto &doc : dr.FindAll()) {
+					loaded.Add(doc);
+				}
+				bool fromFile = loaded.LoadIndexes(path);
+				std::remove(path.c_str());
+				size_t sparse = loaded.Columns().Row(4000000000u);
+
+				return matches && !expected.empty() && found == expected &&
+				       fromFile && loaded.Columns().Size() == dr.Size() && sparse != Database::MetadataColumns::npos &&
+				       loaded.Columns().Title(sparse) == "Sparse" && loaded.Columns().Published()[sparse] == 2000;
+			}
+		},
+		{
+			"Positive Test: Substring search matches std::string::find",
+			[&] {
+				std::string text;
+				for (int i = 0; i < 300; ++i) {
+					text += static_cast<char>('a' + (i * 7) % 5);
+				}
+
+				// Every pattern length and position, including those in the
+				// scalar tail and those straddling a vector block
+				for (size_t length = 1; length <= 40; ++length) {
+					for (size_t from = 0; from + length <= text.size(); from += 13) {
+						Database::SubstringSearch search(text.substr(from, length));
+						for (size_t start = 0; start < text.size(); start += 31) {
+							size_t expected = text.find(search.Pattern(), start);
+							size_t found = search.Find(text, start);
+							if (found != (expected == std::string::npos ? Database::SubstringSearch::npos : expected)) {
+								return false;
+							}
+						}
+					}
+				}
+				return Database::SubstringSearch("zz").Find(text) == Database::SubstringSearch::npos;
+			}
+		},
+		{
+			"Positive Test: Scanning document bodies for substrings",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				std::string filler(1000, 'x');
+				for (unsigned int i = 0; i < 500; ++i) {
+					std::string body = filler;
+					if (i % 10 == 0) body += "needle";
+					if (i % 25 == 0) body = "haystack" + body;
+					dr.Add(Database::Document(i, "a", "b", body));
+				}
+
+				std::vector<std::string> patterns;
+				patterns.push_back("needle");
+				patterns.push_back("haystack");
+
+				size_t counts[2] = { 0, 0 };
+				bool offsets = true;
+				dr.ScanBodies(patterns, [&](const Database::ResearchDocumentRepository::ScanMatch &match) {
+					counts[match.pattern]++;
+					offsets = offsets && match.document->Body().compare(match.offset, patterns[match.pattern].size(), patterns[match.pattern]) == 0;
+					return true;
+				});
+				return offsets && counts[0] == 50 && counts[1] == 20;
+			}
+		},
+		{
+			"Positive Test: Stopping a body scan early",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				for (unsigned int i = 0; i < 500; ++i) {
+					dr.Add(Database::Document(i, "a", "b", "c"));
+				}
+
+				int count = 0;
+				dr.ScanBodies("c", [&](const Database::ResearchDocumentRepository::ScanMatch &) {
+					return ++count < 5;
+				});
+				return count == 5;
+			}
+		},
+		// Negative tests
+		{
+			"Negative Test: Adding multiple documents with same ID",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				Database::Document doc1(0, "a", "b", "c");
+				Database::Document doc2(0, "a", "b", "c");
+				return dr.Add(doc1) &&
+				       dr.Add(doc2) == false &&
+				       dr.FindOneById(0) != nullptr &&
+				       dr.FindAll().size() == 1;
+			}
+		},
+		{
+			"Negative Test: Emplacing multiple documents with same ID",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				return dr.Emplace(0u, "a", "b", "c") &&
+				       dr.Emplace(0u, "aa", "bb", "cc") == false &&
+				       dr.FindManyByAuthor("aa").size() == 0 &&
+				       dr.FindAll().size() == 1;
+			}
+		},
+		{
+			"Negative Test: Retrieval of non-existent document",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				return dr.FindOneById(0) == nullptr &&
+				       dr.FindAll().size() == 0;
+			}
+		},
+		{
+			"Negative Test: Retrieval by non-existent author",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				Database::Document doc1(0, "a", "b", "c");
+				return dr.Add(doc1) &&
+				       dr.FindManyByAuthor("aa").size() == 0 &&
+				       dr.FindAll().size() == 1;
+			}
+		},
+		{
+			"Negative Test: Retrieval by non-existent author that previously existed",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				Database::Document doc1(0, "a", "b", "c");
+				Database::Document doc2(1, "aa", "b", "c");
+				return dr.Add(doc1) &&
+					   dr.Add(doc2) &&
+					   dr.Remove(doc1) &&
+				       dr.FindManyByAuthor("a").size() == 0 &&
+				       dr.FindAll().size() == 1;
+			}
+		},
+		{
+			"Negative Test: Retrieval by non-existent title",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				Database::Document doc1(0, "a", "b", "c");
+				return dr.Add(doc1) &&
+				       dr.FindManyByTitle("bb").size() == 0 &&
+				       dr.FindAll().size() == 1;
+			}
+		},
+		{
+			"Negative Test: Retrieval by non-existent title that previously existed",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				Database::Document doc1(0, "a", "b", "c");
+				Database::Document doc2(1, "a", "bb", "c");
+				return dr.Add(doc1) &&
+					   dr.Add(doc2) &&
+					   dr.Remove(doc1) &&
+				       dr.FindManyByTitle("b").size() == 0 &&
+				       dr.FindAll().size() == 1;
+			}
+		},
+		{
+			"Negative Test: Scanning bodies for a non-existent substring",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				Database::Document doc(0, "a", "needle", "haystack");
+				int count = 0;
+				dr.Add(doc);
+				dr.ScanBodies("needle", [&](const Database::ResearchDocumentRepository::ScanMatch &) {
+					return ++count > 0;
+				});
+				return count == 0;
+			}
+		},
+		{
+			"Negative Test: Updating non-existent document",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				bool called = false;
+				return !dr.Update(0, [&](Database::Document &) { called = true; }) && !called;
+			}
+		},
+		{
+			"Negative Test: Redoing after a new change",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				Database::RepositoryHistory history(dr);
+				return history.Add(Database::Document(0, "a", "b", "c")) &&
+				       history.Undo() &&
+				       history.Add(Database::Document(1, "a", "b", "c")) &&
+				       !history.Redo() &&
+				       dr.FindOneById(0) == nullptr &&
+				       history.Undo() &&
+				       !history.Undo() &&
+				       dr.FindAll().size() == 0;
+			}
+		},
+		{
+			"Negative Test: Erasing from hash index what isn't there",
+			[&] {
+				Database::HashIndex<> index;
+				bool empty = !index.Erase("a", 0) && index.Find("a") == nullptr;
+				index.Insert("a", 0);
+				return empty &&
+				       !index.Erase("a", 1) &&
+				       !index.Erase("b", 0) &&
+				       index.Find("a")->size() == 1;
+			}
+		},
+		{
+			"Negative Test: Breaking a unique index policy",
+			[&] {
+				TagRepository repository;
+				return repository.Add(Tag(0, "a", 1)) &&
+				       repository.Add(Tag(1, "b", 1)) &&
+				       !repository.Add(Tag(2, "a", 2)) &&
+				       !repository.Emplace(2u, "b", 2) &&
+				       !repository.Update(1, [](Tag &tag) { tag.name = "a"; tag.weight = 2; }) &&
+				       repository.FindOneById(1)->name == "b" &&
+				       repository.FindOneById(1)->weight == 1 &&
+				       repository.FindManyBy<ByName>("a").size() == 1 &&
+				       repository.FindManyBy<ByWeight>(2).empty() &&
+				       repository.Size() == 2;
+			}
+		},
+		{
+			"Negative Test: Loading mismatched or corrupt saved indexes",
+			[&] {
+				const std::string path = "test_indexes.rdix";
+
+				Database::ResearchDocumentRepository saved;
+				saved.Add(Database::Document(0, "a", "b", "c"));
+				saved.Add(Database::Document(1, "d", "e", "f"));
+				saved.SaveIndexes(path);
+
+				// Different entities rebuild their own indexes
+				Database::ResearchDocumentRepository changed;
+				changed.DeferIndexing();
+				changed.Add(Database::Document(0, "a", "b", "c"));
+				changed.Add(Database::Document(1, "d", "x", "f"));
+				bool mismatch = !changed.LoadIndexes(path) &&
+				                changed.FindManyByTitle("x").size() == 1 &&
+				                changed.FindManyByTitle("e").empty();
+
+				// Flip a byte in the payload
+				std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+				file.seekp(-1, std::ios::end);
+				file.put('\x7f');
+				file.close();
+
+				Database::ResearchDocumentRepository corrupt;
+				corrupt.DeferIndexing();
+				corrupt.Add(Database::Document(0, "a", "b", "c"));
+				corrupt.Add(Database::Document(1, "d", "e", "f"));
+				bool corrupted = !corrupt.LoadIndexes(path) &&
+				                 corrupt.FindManyByAuthor("d").size() == 1;
+				std::remove(path.c_str());
+
+				Database::ResearchDocumentRepository missing;
+				missing.Add(Database::Document(0, "a", "b", "c"));
+				return mismatch && corrupted &&
+				       !missing.LoadIndexes(path) &&
+				       missing.FindManyByTitle("b").size() == 1;
+			}
+		},
+		{
+			"Negative Test: Loading a hash index saved with another key type",
+			[&] {
+				Database::HashIndex<uint64_t> saved;
+				saved.Insert(1, 0);
+				saved.Insert(2, 1);
+				Database::BinaryWriter writer;
+				saved.Save(writer);
+
+				// The keys are the wrong size to decode
+				Database::HashIndex<uint32_t> loaded;
+				loaded.Insert(3, 2);
+				Database::BinaryReader reader(writer.Buffer().data(), writer.Buffer().size());
+				return !loaded.Load(reader) &&
+				       loaded.Find(1) == nullptr &&
+				       loaded.Find(3) == nullptr;
+			}
+		},
+		{
+			"Negative Test: Following a damaged change feed",
+			[&] {
+				Database::ResearchDocumentRepository primary;
+				primary.Add(Database::Document(0, "a", "b", "c"));
+				primary.Add(Database::Document(1, "d", "e", "f"));
+
+				std::stringstream stream;
+				Database::ChangeFeed feed(primary, stream);
+				std::string bytes = stream.str();
+
+				// Damage the second record's contents
+				std::string damaged = bytes;
+				damaged[damaged.size() - 1] ^= 0x7f;
+				std::stringstream in(damaged);
+				Database::ResearchDocumentRepository follower;
+				Database::ReplicationFollower replica(follower, in);
+				bool corrupt = replica.Poll() == 1 && replica.Progress().failed && replica.Poll() == 0;
+
+				// Damage the second record's length, claiming it runs on for gigabytes
+				uint32_t first = 0;
+				std::memcpy(&first, bytes.data(), sizeof(first));
+				std::string overlong = bytes;
+				std::memset(&overlong[sizeof(uint32_t) + sizeof(uint64_t) + first], 0xff, sizeof(uint32_t));
+				std::stringstream longIn(overlong);
+				Database::ResearchDocumentRepository longFollower;
+				Database::ReplicationFollower longReplica(longFollower, longIn);
+				bool tooLong = longReplica.Poll() == 1 && longReplica.Progress().failed && longFollower.Size() == 1;
+
+				// Skip the first record, leaving a gap in the sequence
+				std::stringstream gap(bytes.substr(bytes.size() / 2));
+				Database::ResearchDocumentRepository other;
+				Database::ReplicationFollower skipped(other, gap);
+				return corrupt && tooLong && follower.Size() == 1 &&
+				       skipped.Poll() == 0 && skipped.Progress().failed && other.Size() == 0;
+			}
+		},
+		{
+			"Negative Test: Cancelled search finds nothing",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				for (unsigned int i = 0; i < 100; ++i) {
+					dr.Add(Database::Document(i, "Author", "Title" + std::to_string(i), "Document Text"));
+				}
+
+				int checks = 0;
+				auto found = dr.FindMatching("title", [&] { return ++checks > 10; });
+				return found.empty() && checks == 11 && dr.FindMatching("title").size() == 100;
+			}
+		},
+		{
+			"Negative Test: Replaying a workload cut short",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				std::stringstream recorded;
+				{
+					Database::WorkloadRecorder recorder(dr, recorded);
+					dr.Add(Database::Document(0, "Edwin Dusty", "A Title", "Document Text"));
+					dr.Add(Database::Document(1, "Jarrod Otis", "Another Title", "Document Text"));
+				}
+
+				std::string bytes = recorded.str();
+				std::istringstream truncated(bytes.substr(0, bytes.size() - 3)), other("Not a workload");
+
+				Database::ResearchDocumentRepository replayed;
+				Database::WorkloadReplay replay(replayed), rejected(replayed);
+				bool read = replay.Read(truncated);
+				replay.Run();
+
+				return read && !replay.Complete() && replay.Size() == 1 && replayed.Size() == 1 &&
+				       !rejected.Read(other) && rejected.Size() == 0;
+			}
+		},
+		{
+			"Negative Test: Memory budget with a spill file that can't be written",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				for (unsigned int i = 0; i < 100; ++i) {
+					dr.Add(Database::Document(i, "a", "b", std::string(10000, 'x')));
+				}
+				bool refused = !dr.SetMemoryBudget(100000, "/nonexistent-dir/spill.bin");
+				dr.Add(Database::Document(100, "a", "b", std::string(10000, 'x')));
+
+				// A store that fails to write leaves bodies in memory
+				struct FullStore : Database::BodyStore {
+					bool Write(const std::string &, uint64_t &) override {
+						return false;
+					}
+					bool Read(uint64_t, std::string &) const override {
+						return false;
+					}
+				} full;
+				Database::Document doc(0, "a", "b", "body");
+				bool kept = !doc.Evict(full) && doc.Resident() && doc.Body() == "body";
+
+				bool intact = true;
+				for (auto &document : dr.FindAll()) {
+					intact = intact && document.Resident() && document.Body().size() == 10000;
+				}
+				return refused && kept && intact && dr.Size() == 101 && dr.SpilledMemory() == 0;
+			}
+		},
+		{
+			"Negative Test: Removal of non-existent document",
+			[&] {
+				Database::ResearchDocumentRepository dr;
+				Database::Document doc(0, "a", "b", "c");
+				return !dr.Remove(doc);
+			}
+		},
+
+	};
+
+	// Iterate over and execute tests
+	for (auto test : tests) {
+#ifdef QT_TESTLIB_LIB
+		qDebug() << QString::fromStdString(test.name) << "\n\t" << "Passed: " << test.func() << "\n";
+#else
+		std::cout << test.name << "\n\t" << "Passed: " << test.func() << "\n\n";
+#endif
+	}
 }
\ No newline at end of file